@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    ChainSettings.cpp
+    One plain struct holding every parameter the chain is built from, and the
+    ways of filling it: from the live parameters, from a preset's stored values
+    or part way between two presets.
+
+  ==============================================================================
+*/
+
+#include "ChainSettings.h"
+
+namespace
+{
+    template <typename Lookup>
+    ChainSettings readChainSettings(Lookup&& valueOf)
+    {
+        ChainSettings tempsetting;
+        tempsetting.Gain = valueOf("Gain");
+
+        tempsetting.LowCutoff = valueOf("LowCutoff");
+        tempsetting.PeakFreq = valueOf("PeakFreq");
+        tempsetting.HighCutoff = valueOf("HighCutoff");
+        tempsetting.PeakGain = valueOf("PeakGain");
+        tempsetting.PeakQuality = valueOf("PeakQuality");
+
+        tempsetting.RoomSize = valueOf("RoomSize");
+        tempsetting.Width = valueOf("Width");
+        tempsetting.Wet = valueOf("Wet");
+        tempsetting.Dry = valueOf("Dry");
+
+        tempsetting.LfoRate = valueOf("LfoRate");
+        tempsetting.EnvAttack = valueOf("EnvAttack");
+        tempsetting.EnvRelease = valueOf("EnvRelease");
+        tempsetting.LfoToLowCut = valueOf("LfoToLowCut");
+        tempsetting.LfoToPeak = valueOf("LfoToPeak");
+        tempsetting.LfoToHighCut = valueOf("LfoToHighCut");
+        tempsetting.LfoToGain = valueOf("LfoToGain");
+        tempsetting.EnvToLowCut = valueOf("EnvToLowCut");
+        tempsetting.EnvToPeak = valueOf("EnvToPeak");
+        tempsetting.EnvToHighCut = valueOf("EnvToHighCut");
+        tempsetting.EnvToGain = valueOf("EnvToGain");
+
+        tempsetting.DuckDepth = valueOf("DuckDepth");
+        tempsetting.DuckAttack = valueOf("DuckAttack");
+        tempsetting.DuckRelease = valueOf("DuckRelease");
+
+        tempsetting.Curve = (int)valueOf("Curve");
+        tempsetting.OversamplingFactor = (int)valueOf("Oversampling");
+        tempsetting.OversamplingFilter = (int)valueOf("OversamplingFilter");
+
+        tempsetting.LowCutSlope = (int)valueOf("LowCutSlope");
+        tempsetting.HighCutSlope = (int)valueOf("HighCutSlope");
+        tempsetting.CutFilter = (int)valueOf("CutFilter");
+        tempsetting.ReverbMode = (int)valueOf("ReverbMode");
+        tempsetting.ReverbRate = (int)valueOf("ReverbRate");
+        tempsetting.StageOrder = (int)valueOf("StageOrder");
+
+        tempsetting.WaveShapeBypass = valueOf("WaveShapeBypass") >= 0.5f;
+        tempsetting.LowCutBypass = valueOf("LowCutBypass") >= 0.5f;
+        tempsetting.PeakBypass = valueOf("PeakBypass") >= 0.5f;
+        tempsetting.HighCutBypass = valueOf("HighCutBypass") >= 0.5f;
+        tempsetting.ReverbBypass = valueOf("ReverbBypass") >= 0.5f;
+
+        return tempsetting;
+    }
+}
+
+int getParameterIndex(const juce::String& id) noexcept
+{
+    for (int i = 0; i < numParameters; ++i)
+        if (id == parameterIDs[i])
+            return i;
+
+    return -1;
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    return readChainSettings([&](const char* id) { return apvts.getRawParameterValue(id)->load(); });
+}
+
+ChainSettings getChainSettings(const float* values)
+{
+    return readChainSettings([=](const char* id) { return values[getParameterIndex(id)]; });
+}
+
+ChainSettings morphChainSettings(const ChainSettings& a, const ChainSettings& b, float position) noexcept
+{
+    position = juce::jlimit(0.0f, 1.0f, position);
+
+    auto linear = [=](float from, float to) { return from + (to - from) * position; };
+    auto geometric = [=](float from, float to) { return from * std::pow(to / from, position); };
+    auto pick = [=](auto from, auto to) { return position < 0.5f ? from : to; };
+
+    ChainSettings settings;
+    settings.Gain = linear(a.Gain, b.Gain);
+    settings.LowCutoff = geometric(a.LowCutoff, b.LowCutoff);
+    settings.PeakFreq = geometric(a.PeakFreq, b.PeakFreq);
+    settings.HighCutoff = geometric(a.HighCutoff, b.HighCutoff);
+    settings.PeakGain = linear(a.PeakGain, b.PeakGain);
+    settings.PeakQuality = geometric(a.PeakQuality, b.PeakQuality);
+
+    settings.RoomSize = linear(a.RoomSize, b.RoomSize);
+    settings.Width = linear(a.Width, b.Width);
+    settings.Wet = linear(a.Wet, b.Wet);
+    settings.Dry = linear(a.Dry, b.Dry);
+
+    settings.LfoRate = geometric(a.LfoRate, b.LfoRate);
+    settings.EnvAttack = geometric(a.EnvAttack, b.EnvAttack);
+    settings.EnvRelease = geometric(a.EnvRelease, b.EnvRelease);
+    settings.LfoToLowCut = linear(a.LfoToLowCut, b.LfoToLowCut);
+    settings.LfoToPeak = linear(a.LfoToPeak, b.LfoToPeak);
+    settings.LfoToHighCut = linear(a.LfoToHighCut, b.LfoToHighCut);
+    settings.LfoToGain = linear(a.LfoToGain, b.LfoToGain);
+    settings.EnvToLowCut = linear(a.EnvToLowCut, b.EnvToLowCut);
+    settings.EnvToPeak = linear(a.EnvToPeak, b.EnvToPeak);
+    settings.EnvToHighCut = linear(a.EnvToHighCut, b.EnvToHighCut);
+    settings.EnvToGain = linear(a.EnvToGain, b.EnvToGain);
+
+    settings.DuckDepth = linear(a.DuckDepth, b.DuckDepth);
+    settings.DuckAttack = geometric(a.DuckAttack, b.DuckAttack);
+    settings.DuckRelease = geometric(a.DuckRelease, b.DuckRelease);
+
+    settings.Curve = pick(a.Curve, b.Curve);
+    settings.OversamplingFactor = pick(a.OversamplingFactor, b.OversamplingFactor);
+    settings.OversamplingFilter = pick(a.OversamplingFilter, b.OversamplingFilter);
+
+    settings.LowCutSlope = pick(a.LowCutSlope, b.LowCutSlope);
+    settings.HighCutSlope = pick(a.HighCutSlope, b.HighCutSlope);
+    settings.CutFilter = pick(a.CutFilter, b.CutFilter);
+    settings.ReverbMode = pick(a.ReverbMode, b.ReverbMode);
+    settings.ReverbRate = pick(a.ReverbRate, b.ReverbRate);
+    settings.StageOrder = pick(a.StageOrder, b.StageOrder);
+
+    settings.WaveShapeBypass = pick(a.WaveShapeBypass, b.WaveShapeBypass);
+    settings.LowCutBypass = pick(a.LowCutBypass, b.LowCutBypass);
+    settings.PeakBypass = pick(a.PeakBypass, b.PeakBypass);
+    settings.HighCutBypass = pick(a.HighCutBypass, b.HighCutBypass);
+    settings.ReverbBypass = pick(a.ReverbBypass, b.ReverbBypass);
+
+    return settings;
+}
@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    ChainSettings.h
+    One plain struct holding every parameter the chain is built from, and the
+    ways of filling it: from the live parameters, from a preset's stored values
+    or part way between two presets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct ChainSettings
+{
+    float Gain, HighCutoff, LowCutoff, PeakFreq, PeakQuality, PeakGain, RoomSize, Width, Dry, Wet;
+    float LfoRate, EnvAttack, EnvRelease, DuckDepth, DuckAttack, DuckRelease;
+    float LfoToLowCut, LfoToPeak, LfoToHighCut, LfoToGain, EnvToLowCut, EnvToPeak, EnvToHighCut, EnvToGain;
+    int Curve, OversamplingFactor, OversamplingFilter, LowCutSlope, HighCutSlope, CutFilter, ReverbMode, ReverbRate, StageOrder;
+    bool WaveShapeBypass, LowCutBypass, PeakBypass, HighCutBypass, ReverbBypass;
+};
+
+/// Every parameter a preset carries, in the order presets store their values.
+inline constexpr const char* parameterIDs[] =
+{
+    "Gain", "LowCutoff", "HighCutoff", "PeakFreq", "PeakQuality", "PeakGain", "RoomSize", "Width", "Dry", "Wet",
+    "Curve", "Oversampling", "OversamplingFilter", "LowCutSlope", "HighCutSlope", "CutFilter", "ReverbMode",
+    "ReverbRate", "StageOrder",
+    "LfoRate", "EnvAttack", "EnvRelease",
+    "LfoToLowCut", "LfoToPeak", "LfoToHighCut", "LfoToGain", "EnvToLowCut", "EnvToPeak", "EnvToHighCut", "EnvToGain",
+    "DuckDepth", "DuckAttack", "DuckRelease",
+    "WaveShapeBypass", "LowCutBypass", "PeakBypass", "HighCutBypass", "ReverbBypass"
+};
+
+inline constexpr int numParameters = (int)std::size(parameterIDs);
+
+/// The position of id in parameterIDs, or -1.
+int getParameterIndex(const juce::String& id) noexcept;
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+
+/// From numParameters plain (not normalised) values in parameterIDs order.
+ChainSettings getChainSettings(const float* values);
+
+/// Part way from a to b. Frequencies, Q and times move geometrically, the other continuous
+/// values linearly, and choices and bypasses switch over half way.
+ChainSettings morphChainSettings(const ChainSettings& a, const ChainSettings& b, float position) noexcept;
@@ -0,0 +1,501 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.cpp
+    The convolution mode of the Reverberation stage. Impulse responses are
+    decoded, resampled and partitioned on a background thread, cached on disk in
+    partitioned form, and handed to the audio thread without locking.
+
+  ==============================================================================
+*/
+
+#include "ConvolutionReverb.h"
+
+namespace
+{
+    /** Band-limited resampling for impulse responses: a Blackman-windowed sinc with
+        its cutoff just under the lower of the two Nyquist frequencies. Decimating a
+        higher-rate IR drops its top octave rather than folding it into the tail.
+    */
+    class SincResampler
+    {
+    public:
+        SincResampler()
+        {
+            // One side of the kernel, in steps of 1/tableResolution zero crossings.
+            table.resize((size_t)(halfTaps * tableResolution + 2));
+
+            for (size_t i = 0; i < table.size(); ++i)
+            {
+                auto u = (double)i / tableResolution;
+                auto t = juce::jmin(1.0, u / halfTaps);
+                auto window = 0.42 + 0.5 * std::cos(juce::MathConstants<double>::pi * t)
+                            + 0.08 * std::cos(juce::MathConstants<double>::twoPi * t);
+                auto sinc = i == 0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * u) / (juce::MathConstants<double>::pi * u);
+
+                table[i] = (float)(sinc * window);
+            }
+        }
+
+        /// ratio is source samples per output sample. Writes numOutputSamples samples of
+        /// the resampled signal, starting with sample firstOutput, to output.
+        void process(double ratio, const float* source, int sourceLength, float* output, int firstOutput, int numOutputSamples) const noexcept
+        {
+            // Zero crossings land cutoff apart in source samples, so the kernel widens
+            // with the decimation ratio and its gain drops to match.
+            auto cutoff = passband / juce::jmax(1.0, ratio);
+            auto halfWidth = halfTaps / cutoff;
+
+            for (int n = 0; n < numOutputSamples; ++n)
+            {
+                auto centre = (firstOutput + n) * ratio;
+                auto first = juce::jmax(0, (int)std::ceil(centre - halfWidth));
+                auto last = juce::jmin(sourceLength - 1, (int)std::floor(centre + halfWidth));
+                auto sum = 0.0;
+
+                for (int k = first; k <= last; ++k)
+                {
+                    auto position = std::abs(k - centre) * cutoff * tableResolution;
+                    auto index = (int)position;
+                    auto fraction = (float)(position - index);
+                    auto tap = table[(size_t)index] + fraction * (table[(size_t)index + 1] - table[(size_t)index]);
+
+                    sum += (double)(source[k] * tap);
+                }
+
+                output[n] = (float)(sum * cutoff);
+            }
+        }
+
+        /// Output samples resampled between checks for the loader being stopped.
+        static constexpr int chunkSize = 16384;
+
+    private:
+        // 64 zero crossings either side put the transition band inside the last 5%
+        // below Nyquist, where the Blackman window is down about 74 dB.
+        static constexpr int halfTaps = 64;
+        static constexpr int tableResolution = 256;
+        static constexpr double passband = 0.95;
+
+        std::vector<float> table;
+    };
+}
+
+ConvolutionReverb::ConvolutionReverb() : juce::Thread("AudioFX IR loader")
+{
+}
+
+ConvolutionReverb::~ConvolutionReverb()
+{
+    stopThread(4000);
+    deleteAllEngines();
+}
+
+void ConvolutionReverb::prepare(const juce::dsp::ProcessSpec& spec, bool buildNow)
+{
+    stopThread(4000);
+    deleteRetired();
+
+    sampleRate = spec.sampleRate;
+    numChannels = (int)spec.numChannels;
+    maxBlockSize = (int)spec.maximumBlockSize;
+
+    wet.setSize(numChannels, maxBlockSize);
+    fadingWet.setSize(numChannels, maxBlockSize);
+    dryRamp.allocate((size_t)maxBlockSize, true);
+    wetRamp.allocate((size_t)maxBlockSize, true);
+
+    dryGain.reset(sampleRate, 0.01);
+    wetGain.reset(sampleRate, 0.01);
+    fadeLength = juce::jmax(1, juce::roundToInt(sampleRate * crossfadeSeconds));
+
+    // The stage starts over, so a crossfade in progress is dropped and the newest
+    // engine is kept, as long as it was built for this rate and layout.
+    if (auto* pending = pendingEngine.exchange(nullptr))
+    {
+        if (suits(*pending))
+            delete std::exchange(current, pending);
+        else
+            delete pending;
+    }
+
+    delete std::exchange(fadingOut, nullptr);
+    delete std::exchange(retireBacklog, nullptr);
+
+    if (current != nullptr && ! suits(*current))
+        delete std::exchange(current, nullptr);
+
+    if (current != nullptr)
+        for (auto* convolver : current->convolvers)
+            convolver->reset();
+
+    // Only an IR that's missing, stale or still queued is built again.
+    juce::File file;
+    auto build = false;
+
+    {
+        const juce::ScopedLock sl(fileLock);
+        file = requestedFile;
+        build = loadRequested || (file != juce::File() && (current == nullptr || current->file != file));
+        loadRequested = build && ! buildNow;
+    }
+
+    // The loader has nothing queued when the build happens here. It's started first
+    // because threadShouldExit() stays set from stopThread() until then, and would cut
+    // buildEngine() short.
+    startThread();
+
+    if (build && buildNow)
+        if (auto engine = buildEngine(file))
+            delete std::exchange(current, engine.release());
+
+    updateTailLength();
+}
+
+void ConvolutionReverb::reset() noexcept
+{
+    if (current != nullptr)
+        for (auto* convolver : current->convolvers)
+            convolver->reset();
+
+    // The outgoing engine's tail belongs to the audio before the reset.
+    if (fadingOut != nullptr)
+        endFade();
+
+    dryGain.setCurrentAndTargetValue(dryGain.getTargetValue());
+    wetGain.setCurrentAndTargetValue(wetGain.getTargetValue());
+}
+
+void ConvolutionReverb::loadImpulseResponse(const juce::File& file)
+{
+    {
+        const juce::ScopedLock sl(fileLock);
+        requestedFile = file;
+        loadRequested = true;
+    }
+
+    notify();
+}
+
+juce::File ConvolutionReverb::getImpulseResponseFile() const
+{
+    const juce::ScopedLock sl(fileLock);
+    return requestedFile;
+}
+
+void ConvolutionReverb::setMix(float dryLevel, float wetLevel) noexcept
+{
+    dryGain.setTargetValue(dryLevel);
+    wetGain.setTargetValue(wetLevel);
+}
+
+double ConvolutionReverb::getTailLengthSeconds() const noexcept
+{
+    return tailSeconds.load();
+}
+
+void ConvolutionReverb::process(const juce::dsp::ProcessContextReplacing<float>& context, RenderPool* pool) noexcept
+{
+    auto& block = context.getOutputBlock();
+    auto numSamples = (int)block.getNumSamples();
+    auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    const juce::ScopedValueSetter<const float*> modulation(wetModulation, wetModulation, nullptr);
+
+    jassert(numSamples <= maxBlockSize);
+
+    // Engines are only ever freed by the loader thread; one that couldn't be handed
+    // back last time is retried before anything new is taken.
+    if (retireBacklog != nullptr && retire(retireBacklog))
+        retireBacklog = nullptr;
+
+    if (fadingOut == nullptr && retireBacklog == nullptr)
+    {
+        if (auto* next = pendingEngine.exchange(nullptr))
+        {
+            fadingOut = current;
+            current = next;
+            fadePosition = 0;
+            updateTailLength();
+        }
+    }
+
+    auto startGain = (float)fadePosition / (float)fadeLength;
+    auto endGain = juce::jmin(1.0f, (float)(fadePosition + numSamples) / (float)fadeLength);
+
+    // Channels share nothing but the IR, so each one is a task of its own. The buffers'
+    // pointers are fetched up front, as that marks them non-clear.
+    auto* const* wetChannels = wet.getArrayOfWritePointers();
+    auto* const* fadingChannels = fadingWet.getArrayOfWritePointers();
+
+    forEachTask(pool, channels, [&](int ch)
+    {
+        auto* incoming = wetChannels[ch];
+
+        if (current != nullptr)
+            current->convolvers.getUnchecked(ch)->process(block.getChannelPointer((size_t)ch), incoming, numSamples);
+        else
+            juce::FloatVectorOperations::clear(incoming, numSamples);
+
+        if (fadingOut == nullptr)
+            return;
+
+        auto* outgoing = fadingChannels[ch];
+        fadingOut->convolvers.getUnchecked(ch)->process(block.getChannelPointer((size_t)ch), outgoing, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto gain = juce::jmin(1.0f, startGain + (endGain - startGain) * (float)i / (float)numSamples);
+            incoming[i] = outgoing[i] + (incoming[i] - outgoing[i]) * gain;
+        }
+    });
+
+    if (fadingOut != nullptr)
+    {
+        fadePosition += numSamples;
+
+        if (fadePosition >= fadeLength)
+            endFade();
+    }
+
+    // Mix back into the block, with per-sample gains only while they move.
+    auto smoothing = dryGain.isSmoothing() || wetGain.isSmoothing();
+
+    if (smoothing)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            dryRamp[i] = dryGain.getNextValue();
+            wetRamp[i] = wetGain.getNextValue();
+        }
+    }
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        auto* samples = block.getChannelPointer((size_t)ch);
+        auto* wetSamples = wet.getWritePointer(ch);
+
+        if (smoothing)
+        {
+            juce::FloatVectorOperations::multiply(samples, dryRamp, numSamples);
+            juce::FloatVectorOperations::multiply(wetSamples, wetRamp, numSamples);
+        }
+        else
+        {
+            juce::FloatVectorOperations::multiply(samples, dryGain.getCurrentValue(), numSamples);
+            juce::FloatVectorOperations::multiply(wetSamples, wetGain.getCurrentValue(), numSamples);
+        }
+
+        if (wetModulation != nullptr)
+            juce::FloatVectorOperations::multiply(wetSamples, wetModulation, numSamples);
+
+        juce::FloatVectorOperations::add(samples, wetSamples, numSamples);
+    }
+}
+
+//==============================================================================
+void ConvolutionReverb::run()
+{
+    while (! threadShouldExit())
+    {
+        deleteRetired();
+
+        juce::File file;
+        auto load = false;
+
+        {
+            const juce::ScopedLock sl(fileLock);
+            std::swap(load, loadRequested);
+            file = requestedFile;
+        }
+
+        if (load)
+        {
+            if (auto engine = buildEngine(file))
+            {
+                // One the audio thread never picked up can go straight away.
+                if (auto* unused = pendingEngine.exchange(engine.release()))
+                    delete unused;
+            }
+            else if (threadShouldExit())
+            {
+                // Abandoned part-way; whoever restarts the loader picks it up again.
+                const juce::ScopedLock sl(fileLock);
+                loadRequested = true;
+            }
+        }
+
+        wait(50);
+    }
+}
+
+std::unique_ptr<ConvolutionReverb::Engine> ConvolutionReverb::buildEngine(const juce::File& file) const
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    juce::int64 key = 0;
+    auto cacheFile = getCacheFile(file, sampleRate, key);
+    auto ir = PartitionedIR::loadFromCache(cacheFile, key);
+
+    if (ir == nullptr)
+    {
+        auto impulse = readImpulse(file);
+
+        if (impulse.getNumSamples() == 0 || threadShouldExit())
+            return nullptr;
+
+        ir = PartitionedIR::build(impulse);
+
+        if (threadShouldExit())
+            return nullptr;
+
+        // Best effort: without a cache entry the next load just partitions again.
+        if (cacheFile.getParentDirectory().createDirectory())
+            ir->writeToCache(cacheFile, key);
+    }
+
+    auto engine = std::make_unique<Engine>();
+    engine->file = file;
+    engine->sampleRate = sampleRate;
+    engine->ir = std::move(ir);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        engine->convolvers.add(new PartitionedConvolver(*engine->ir, ch));
+
+    return engine;
+}
+
+juce::AudioBuffer<float> ConvolutionReverb::readImpulse(const juce::File& file) const
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+        return {};
+
+    // Mono IRs feed every channel; stereo ones feed left and right, and further
+    // channels reuse the right.
+    auto irChannels = juce::jmin(2, (int)reader->numChannels);
+    auto sourceLength = (int)juce::jmin(reader->lengthInSamples, (juce::int64)(maxImpulseSeconds * reader->sampleRate));
+
+    juce::AudioBuffer<float> source(irChannels, sourceLength);
+    source.clear();
+    reader->read(&source, 0, sourceLength, 0, true, irChannels > 1);
+
+    auto ratio = reader->sampleRate / sampleRate;
+    auto length = juce::jmax(1, (int)std::ceil(sourceLength / ratio));
+    juce::AudioBuffer<float> impulse(irChannels, length);
+    SincResampler resampler;
+
+    for (int ch = 0; ch < irChannels; ++ch)
+    {
+        if (ratio == 1.0)
+        {
+            impulse.copyFrom(ch, 0, source, ch, 0, length);
+            continue;
+        }
+
+        // A long IR takes a while to resample, so the loader can be stopped in between.
+        for (int start = 0; start < length; start += SincResampler::chunkSize)
+        {
+            if (threadShouldExit())
+                return {};
+
+            resampler.process(ratio, source.getReadPointer(ch), sourceLength, impulse.getWritePointer(ch, start),
+                              start, juce::jmin(SincResampler::chunkSize, length - start));
+        }
+    }
+
+    // Unit energy in the loudest channel, so the Wet level means the same for any IR.
+    auto maxEnergy = 0.0f;
+
+    for (int ch = 0; ch < irChannels; ++ch)
+    {
+        auto* samples = impulse.getReadPointer(ch);
+        auto energy = 0.0f;
+
+        for (int i = 0; i < length; ++i)
+            energy += samples[i] * samples[i];
+
+        maxEnergy = juce::jmax(maxEnergy, energy);
+    }
+
+    if (maxEnergy > 0.0f)
+        impulse.applyGain(1.0f / std::sqrt(maxEnergy));
+
+    return impulse;
+}
+
+juce::File ConvolutionReverb::getCacheFile(const juce::File& impulseFile, double rate, juce::int64& key)
+{
+    // Any edit to the file, or a different session rate, gives a different entry.
+    auto description = impulseFile.getFullPathName()
+                     + "|" + juce::String(impulseFile.getSize())
+                     + "|" + juce::String(impulseFile.getLastModificationTime().toMilliseconds())
+                     + "|" + juce::String(rate);
+
+    key = description.hashCode64();
+
+    return juce::File::getSpecialLocation(juce::File::tempDirectory)
+        .getChildFile("AudioFX IR Cache")
+        .getChildFile(juce::String::toHexString(key) + ".afxir");
+}
+
+//==============================================================================
+bool ConvolutionReverb::suits(const Engine& engine) const noexcept
+{
+    return engine.sampleRate == sampleRate && engine.convolvers.size() == numChannels;
+}
+
+bool ConvolutionReverb::retire(Engine* engine) noexcept
+{
+    int start1, size1, start2, size2;
+    retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    retired[size1 > 0 ? start1 : start2] = engine;
+    retiredFifo.finishedWrite(1);
+    return true;
+}
+
+void ConvolutionReverb::endFade() noexcept
+{
+    if (! retire(fadingOut))
+        retireBacklog = fadingOut;
+
+    fadingOut = nullptr;
+}
+
+void ConvolutionReverb::deleteRetired()
+{
+    int start1, size1, start2, size2;
+    retiredFifo.prepareToRead(retiredFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        delete std::exchange(retired[start1 + i], nullptr);
+
+    for (int i = 0; i < size2; ++i)
+        delete std::exchange(retired[start2 + i], nullptr);
+
+    retiredFifo.finishedRead(size1 + size2);
+}
+
+void ConvolutionReverb::deleteAllEngines()
+{
+    deleteRetired();
+
+    delete pendingEngine.exchange(nullptr);
+    delete std::exchange(current, nullptr);
+    delete std::exchange(fadingOut, nullptr);
+    delete std::exchange(retireBacklog, nullptr);
+    updateTailLength();
+}
+
+void ConvolutionReverb::updateTailLength() noexcept
+{
+    tailSeconds = current != nullptr ? current->ir->getLength() / sampleRate : 0.0;
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.h
+    The convolution mode of the Reverberation stage. Impulse responses are
+    decoded, resampled and partitioned on a background thread, cached on disk in
+    partitioned form, and handed to the audio thread without locking.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+#include "RenderPool.h"
+
+class ConvolutionReverb : private juce::Thread
+{
+public:
+    /// Longer files are cut off here.
+    static constexpr double maxImpulseSeconds = 20.0;
+
+    ConvolutionReverb();
+    ~ConvolutionReverb() override;
+
+    /// Keeps the current IR when neither the file, the rate nor the channel count has
+    /// changed. Otherwise the IR is rebuilt: before this returns when buildNow is set,
+    /// as an offline render needs it from the first block, and on the loader thread
+    /// when it isn't, with the wet signal silent until it's ready. Allocates, so never
+    /// from the audio thread.
+    void prepare(const juce::dsp::ProcessSpec& spec, bool buildNow);
+
+    /// Clears the convolvers' history and ends any crossfade.
+    void reset() noexcept;
+
+    /// Queues a file for the loader thread. When it's ready the audio thread swaps it
+    /// in and crossfades from the old one. Call from any thread but the audio thread.
+    void loadImpulseResponse(const juce::File& file);
+
+    /// The last file asked for, whether or not it has finished loading.
+    juce::File getImpulseResponseFile() const;
+
+    void setMix(float dryLevel, float wetLevel) noexcept;
+
+    /// A per-sample gain on the wet signal, for the next process() call only. nullptr
+    /// for none.
+    void setWetModulation(const float* gains) noexcept { wetModulation = gains; }
+
+    /// The length of the IR currently playing, or 0 before one has loaded. Safe to
+    /// call from any thread.
+    double getTailLengthSeconds() const noexcept;
+
+    /// With a pool, each channel's convolution (and crossfade) runs as its own task.
+    void process(const juce::dsp::ProcessContextReplacing<float>& context, RenderPool* pool = nullptr) noexcept;
+
+private:
+    /// An IR and one convolver per channel, always built and freed off the audio thread.
+    struct Engine
+    {
+        juce::File file;
+        double sampleRate = 0.0;
+        std::unique_ptr<PartitionedIR> ir;
+        juce::OwnedArray<PartitionedConvolver> convolvers;
+    };
+
+    static constexpr int retiredCapacity = 8;
+    static constexpr double crossfadeSeconds = 0.05;
+
+    // Loader side. requestedFile is only touched under fileLock.
+    juce::CriticalSection fileLock;
+    juce::File requestedFile;
+    bool loadRequested = false;
+
+    // Hand-over. The loader publishes into pendingEngine; the audio thread pushes
+    // engines it has finished with into the retired FIFO for the loader to delete.
+    std::atomic<Engine*> pendingEngine{ nullptr };
+    juce::AbstractFifo retiredFifo{ retiredCapacity };
+    Engine* retired[retiredCapacity] = {};
+
+    // Audio side. Outside process() and reset(), only changed in prepare(), which the
+    // loader never touches them from.
+    Engine* current = nullptr;
+    Engine* fadingOut = nullptr;
+    Engine* retireBacklog = nullptr;
+    int fadePosition = 0, fadeLength = 1;
+    std::atomic<double> tailSeconds{ 0.0 };
+
+    double sampleRate = 44100.0;
+    int numChannels = 2, maxBlockSize = 0;
+
+    juce::AudioBuffer<float> wet, fadingWet;
+    juce::HeapBlock<float> dryRamp, wetRamp;
+    juce::SmoothedValue<float> dryGain, wetGain;
+    const float* wetModulation = nullptr;
+
+    void run() override;
+
+    /// Returns nullptr for an unreadable file, or when the loader is asked to stop
+    /// part-way through.
+    std::unique_ptr<Engine> buildEngine(const juce::File& file) const;
+    juce::AudioBuffer<float> readImpulse(const juce::File& file) const;
+    static juce::File getCacheFile(const juce::File& impulseFile, double rate, juce::int64& key);
+
+    bool suits(const Engine& engine) const noexcept;
+    bool retire(Engine* engine) noexcept;
+    void endFade() noexcept;
+    void deleteRetired();
+    void deleteAllEngines();
+    void updateTailLength() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionReverb)
+};
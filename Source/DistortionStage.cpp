@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    DistortionStage.cpp
+    The WaveShape stage, optionally run at 2x/4x/8x through preallocated
+    juce::dsp::Oversampling instances so the drive doesn't alias.
+
+  ==============================================================================
+*/
+
+#include "DistortionStage.h"
+
+int DistortionStage::getOversamplerIndex(int factorIndex, bool linearPhase) noexcept
+{
+    return (factorIndex - 1) * 2 + (linearPhase ? 1 : 0);
+}
+
+void DistortionStage::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    oversamplers.clear();
+
+    for (int factorIndex = 1; factorIndex < numFactors; ++factorIndex)
+    {
+        for (auto type : { Oversampler::filterHalfBandPolyphaseIIR, Oversampler::filterHalfBandFIREquiripple })
+        {
+            // Integer latency keeps the reported delay exact for the host's compensation.
+            auto* oversampler = oversamplers.add(new Oversampler((size_t)spec.numChannels, (size_t)factorIndex, type, true, true));
+            oversampler->initProcessing((size_t)spec.maximumBlockSize);
+        }
+    }
+
+    jassert(oversamplers.size() == getOversamplerIndex(numFactors, false));
+
+    auto maxLatency = 0;
+
+    for (auto* oversampler : oversamplers)
+        maxLatency = juce::jmax(maxLatency, juce::roundToInt(oversampler->getLatencyInSamples()));
+
+    fadeInput.setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+    latencyDelay.setSize((int)spec.numChannels, juce::jmax(1, maxLatency));
+    bypass.prepare(spec.sampleRate, (int)spec.maximumBlockSize);
+
+    sampleRate = spec.sampleRate;
+    driveRampSize = (size_t)spec.maximumBlockSize << (numFactors - 1);
+    driveRamp.allocate(driveRampSize, true);
+    drive.reset(sampleRate, driveRampSeconds);
+
+    // prepare() is followed by setOversampling(), which picks the active instance.
+    active = nullptr;
+    activeIndex = -1;
+    delayLength = 0;
+    delayPosition = 0;
+}
+
+void DistortionStage::reset()
+{
+    for (auto* oversampler : oversamplers)
+        oversampler->reset();
+
+    drive.setCurrentAndTargetValue(drive.getTargetValue());
+
+    latencyDelay.clear();
+    delayPosition = 0;
+    bypass.reset();
+}
+
+void DistortionStage::setOversampling(int factorIndex, bool linearPhase) noexcept
+{
+    factorIndex = juce::jlimit(0, numFactors - 1, factorIndex);
+    auto index = factorIndex == 0 ? -1 : getOversamplerIndex(factorIndex, linearPhase);
+
+    if (index == activeIndex)
+        return;
+
+    activeIndex = index;
+    active = index < 0 ? nullptr : oversamplers[index];
+
+    // Keeps the glide time the same in seconds; a switch mid-ramp simply lands on the target.
+    drive.reset(sampleRate * (double)(1 << factorIndex), driveRampSeconds);
+
+    // Whatever this instance last held belongs to an older stretch of audio.
+    if (active != nullptr)
+        active->reset();
+
+    delayLength = getLatencySamples();
+    delayPosition = 0;
+    latencyDelay.clear();
+}
+
+int DistortionStage::getLatencySamples() const noexcept
+{
+    return active != nullptr ? juce::roundToInt(active->getLatencyInSamples()) : 0;
+}
+
+void DistortionStage::process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+{
+    auto& block = context.getOutputBlock();
+    const juce::ScopedValueSetter<const float*> modulation(driveModulation, driveModulation, nullptr);
+
+    if (bypass.isOff())
+    {
+        delay(block);
+        return;
+    }
+
+    if (! bypass.isFading())
+    {
+        writeDelay(block);
+        processActive(block);
+        return;
+    }
+
+    auto numSamples = block.getNumSamples();
+    auto input = juce::dsp::AudioBlock<float>(fadeInput).getSubsetChannelBlock(0, block.getNumChannels()).getSubBlock(0, numSamples);
+
+    input.copyFrom(block);
+    processActive(block);
+    delay(input);
+
+    auto* gains = bypass.getNextGains((int)numSamples);
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        StageBypass::crossfade(block.getChannelPointer(ch), input.getChannelPointer(ch), gains, numSamples);
+
+    // Faded out: the next fade in starts from clean filters.
+    if (bypass.isOff() && active != nullptr)
+        active->reset();
+}
+
+void DistortionStage::processActive(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    // Applied at the host rate, ahead of the oversampler, and after the dry side of
+    // the bypass was taken.
+    if (driveModulation != nullptr)
+    {
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::multiply(block.getChannelPointer(ch), driveModulation, (int)block.getNumSamples());
+    }
+
+    if (active == nullptr)
+    {
+        shape(block);
+        return;
+    }
+
+    auto oversampledBlock = active->processSamplesUp(block);
+    shape(oversampledBlock);
+    active->processSamplesDown(block);
+}
+
+void DistortionStage::writeDelay(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    if (delayLength == 0)
+        return;
+
+    auto numSamples = (int)block.getNumSamples();
+    auto position = delayPosition;
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        auto* samples = block.getChannelPointer(ch);
+        auto* line = latencyDelay.getWritePointer((int)ch);
+        position = delayPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line[position] = samples[i];
+
+            if (++position == delayLength)
+                position = 0;
+        }
+    }
+
+    delayPosition = position;
+}
+
+void DistortionStage::delay(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    if (delayLength == 0)
+        return;
+
+    auto numSamples = (int)block.getNumSamples();
+    auto position = delayPosition;
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        auto* samples = block.getChannelPointer(ch);
+        auto* line = latencyDelay.getWritePointer((int)ch);
+        position = delayPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            std::swap(line[position], samples[i]);
+
+            if (++position == delayLength)
+                position = 0;
+        }
+    }
+
+    delayPosition = position;
+}
+
+void DistortionStage::shape(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numSamples = block.getNumSamples();
+
+    if (! drive.isSmoothing())
+    {
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            shapeChannel(block.getChannelPointer(ch), numSamples, drive.getCurrentValue());
+
+        return;
+    }
+
+    // Every channel shares one ramp, so it is filled once and multiplied in before
+    // the curve runs at unity gain.
+    jassert(numSamples <= driveRampSize);
+
+    for (size_t i = 0; i < numSamples; ++i)
+        driveRamp[i] = drive.getNextValue();
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+    {
+        auto* samples = block.getChannelPointer(ch);
+
+        juce::FloatVectorOperations::multiply(samples, driveRamp, (int)numSamples);
+        shapeChannel(samples, numSamples, 1.0f);
+    }
+}
+
+void DistortionStage::shapeChannel(float* samples, size_t numSamples, float gain) const noexcept
+{
+    switch (curve)
+    {
+        case WaveshaperCurve::tanh:     applyCurve<TanhCurve>(samples, numSamples, gain); break;
+        case WaveshaperCurve::softClip: applyCurve<SoftClipCurve>(samples, numSamples, gain); break;
+        case WaveshaperCurve::hardClip: applyCurve<HardClipCurve>(samples, numSamples, gain); break;
+        case WaveshaperCurve::tube:     applyCurve<TubeCurve>(samples, numSamples, gain); break;
+        case WaveshaperCurve::foldback: applyCurve<FoldbackCurve>(samples, numSamples, gain); break;
+    }
+}
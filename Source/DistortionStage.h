@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    DistortionStage.h
+    The WaveShape stage, optionally run at 2x/4x/8x through preallocated
+    juce::dsp::Oversampling instances so the drive doesn't alias.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "WaveshaperCurves.h"
+#include "StageBypass.h"
+
+class DistortionStage
+{
+public:
+    using Oversampler = juce::dsp::Oversampling<float>;
+
+    /// Index 0 is 1x, then 2x, 4x and 8x.
+    static constexpr int numFactors = 4;
+
+    DistortionStage() = default;
+
+    /// Builds every factor/filter combination up front so switching between them
+    /// later never allocates.
+    void prepare(const juce::dsp::ProcessSpec& spec);
+
+    /// Clears the oversampling filters and jumps the drive and bypass straight to
+    /// their targets.
+    void reset();
+
+    /// Linear gain applied in front of the waveshaper curve. Changes glide over
+    /// driveRampSeconds; a steady drive costs nothing extra.
+    void setDrive(float newDrive) noexcept { drive.setTargetValue(newDrive); }
+
+    static constexpr double driveRampSeconds = 0.02;
+
+    /// A per-sample gain on top of the drive, for the next process() call only;
+    /// numSamples values at the host rate. nullptr for none.
+    void setDriveModulation(const float* gains) noexcept { driveModulation = gains; }
+
+    void setCurve(WaveshaperCurve newCurve) noexcept { curve = newCurve; }
+
+    /// Selects the oversampling factor (0 = 1x ... 3 = 8x) and whether the half-band
+    /// filters are the polyphase IIR or the linear-phase FIR design. Safe to call from
+    /// the audio thread.
+    void setOversampling(int factorIndex, bool linearPhase) noexcept;
+
+    /// Latency of the current oversampling setting, in host-rate samples.
+    int getLatencySamples() const noexcept;
+
+    /// Fades the stage out and stops running it. The latency stays the same, so a
+    /// bypassed stage at 2x or more still delays the signal to match.
+    void setBypassed(bool shouldBeBypassed) noexcept { bypass.setBypassed(shouldBeBypassed); }
+    bool isBypassed() const noexcept { return bypass.isBypassed(); }
+
+    /// The drive the curve ran at most recently.
+    float getDrive() const noexcept { return drive.getCurrentValue(); }
+
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept;
+
+private:
+    // Indexed by (factorIndex - 1) * 2 + linearPhase.
+    juce::OwnedArray<Oversampler> oversamplers;
+    Oversampler* active = nullptr;
+    int activeIndex = -1;
+
+    // The drive ramps at whatever rate the curve runs at, so its step size is
+    // recomputed whenever the oversampling factor changes.
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> drive;
+    juce::HeapBlock<float> driveRamp;
+    size_t driveRampSize = 0;
+    const float* driveModulation = nullptr;
+    double sampleRate = 44100.0;
+
+    WaveshaperCurve curve = WaveshaperCurve::tanh;
+
+    // The dry side of the bypass. latencyDelay always holds the last `latency` input
+    // samples, so a fade can start from the right place.
+    StageBypass bypass;
+    juce::AudioBuffer<float> fadeInput, latencyDelay;
+    int delayLength = 0, delayPosition = 0;
+
+    static int getOversamplerIndex(int factorIndex, bool linearPhase) noexcept;
+    void processActive(juce::dsp::AudioBlock<float>& block) noexcept;
+    void writeDelay(const juce::dsp::AudioBlock<float>& block) noexcept;
+    void delay(juce::dsp::AudioBlock<float>& block) noexcept;
+    void shape(juce::dsp::AudioBlock<float>& block) noexcept;
+    void shapeChannel(float* samples, size_t numSamples, float gain) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DistortionStage)
+};
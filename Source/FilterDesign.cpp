@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    FilterDesign.cpp
+    In-place coefficient design for the LowCut, Peak and HighCut stages: as
+    state-variable sections for the chain itself, and as biquads for anything
+    that only needs the response.
+
+  ==============================================================================
+*/
+
+#include "FilterDesign.h"
+
+namespace
+{
+    void storeNormalised(Coefficients& coeffs, double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+        jassert(coeffs.getFilterOrder() == 2);
+
+        auto* raw = coeffs.getRawCoefficients();
+        auto a0inv = 1.0 / a0;
+
+        raw[0] = (float)(b0 * a0inv);
+        raw[1] = (float)(b1 * a0inv);
+        raw[2] = (float)(b2 * a0inv);
+        raw[3] = (float)(a1 * a0inv);
+        raw[4] = (float)(a2 * a0inv);
+    }
+
+    double clampFrequency(double sampleRate, float frequency)
+    {
+        // Keep the bilinear transform away from DC and Nyquist.
+        return juce::jlimit(1.0, sampleRate * 0.499, (double)frequency);
+    }
+
+    void storeSVF(SVFCoefficients& coeffs, double sampleRate, float frequency, double k,
+                  double m0, double m1, double m2) noexcept
+    {
+        auto g = std::tan(juce::MathConstants<double>::pi * clampFrequency(sampleRate, frequency) / sampleRate);
+        auto a1 = 1.0 / (1.0 + g * (g + k));
+
+        coeffs.a1 = (float)a1;
+        coeffs.a2 = (float)(g * a1);
+        coeffs.a3 = (float)(g * g * a1);
+        coeffs.m0 = (float)m0;
+        coeffs.m1 = (float)m1;
+        coeffs.m2 = (float)m2;
+        coeffs.g = (float)g;
+        coeffs.k = (float)k;
+    }
+}
+
+Coefficients::Ptr makeBiquadStorage()
+{
+    return new Coefficients(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+float getButterworthQ(int numSections, int index)
+{
+    // The poles sit evenly on a half circle; each conjugate pair gives one section.
+    auto angle = juce::MathConstants<double>::pi * (2 * index + 1) / (4.0 * numSections);
+    return (float)(0.5 / std::sin(angle));
+}
+
+float getCutSectionQ(int numSections, int index)
+{
+    return numSections == 1 ? 1.0f : getButterworthQ(numSections, index);
+}
+
+void designHighPass(Coefficients& coeffs, double sampleRate, float frequency, float quality)
+{
+    auto n = std::tan(juce::MathConstants<double>::pi * clampFrequency(sampleRate, frequency) / sampleRate);
+    auto nSquared = n * n;
+    auto invQ = 1.0 / quality;
+    auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    storeNormalised(coeffs, c1, c1 * -2.0, c1, 1.0, c1 * 2.0 * (nSquared - 1.0), c1 * (1.0 - invQ * n + nSquared));
+}
+
+void designLowPass(Coefficients& coeffs, double sampleRate, float frequency, float quality)
+{
+    auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * clampFrequency(sampleRate, frequency) / sampleRate);
+    auto nSquared = n * n;
+    auto invQ = 1.0 / quality;
+    auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    storeNormalised(coeffs, c1, c1 * 2.0, c1, 1.0, c1 * 2.0 * (1.0 - nSquared), c1 * (1.0 - invQ * n + nSquared));
+}
+
+void designPeak(Coefficients& coeffs, double sampleRate, float frequency, float quality, float gainFactor)
+{
+    auto A = std::sqrt(juce::jmax(0.0, (double)gainFactor));
+    auto omega = juce::MathConstants<double>::twoPi * clampFrequency(sampleRate, frequency) / sampleRate;
+    auto alpha = std::sin(omega) / (quality * 2.0);
+    auto c2 = -2.0 * std::cos(omega);
+    auto alphaTimesA = alpha * A;
+    auto alphaOverA = alpha / A;
+
+    storeNormalised(coeffs, 1.0 + alphaTimesA, c2, 1.0 - alphaTimesA, 1.0 + alphaOverA, c2, 1.0 - alphaOverA);
+}
+
+void designSVFHighPass(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality) noexcept
+{
+    auto k = 1.0 / quality;
+    storeSVF(coeffs, sampleRate, frequency, k, 1.0, -k, -1.0);
+}
+
+void designSVFLowPass(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality) noexcept
+{
+    storeSVF(coeffs, sampleRate, frequency, 1.0 / quality, 0.0, 0.0, 1.0);
+}
+
+void designSVFPeak(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality, float gainFactor) noexcept
+{
+    // The same prototype as designPeak(): the damping shrinks by A, and the band-pass
+    // is added back scaled so the centre ends up at A squared.
+    auto A = std::sqrt(juce::jmax(1.0e-6, (double)gainFactor));
+    auto k = 1.0 / (quality * A);
+    storeSVF(coeffs, sampleRate, frequency, k, 1.0, k * (A * A - 1.0), 0.0);
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    FilterDesign.h
+    In-place coefficient design for the LowCut, Peak and HighCut stages: as
+    state-variable sections for the chain itself, and as biquads for anything
+    that only needs the response.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+using Coefficients = juce::dsp::IIR::Coefficients<float>;
+
+/// Returns a second-order Coefficients object that the design functions below can write into.
+/// Call this from prepareToPlay (it allocates), never from the audio thread.
+Coefficients::Ptr makeBiquadStorage();
+
+// These mirror Coefficients::makeHighPass / makeLowPass / makePeakFilter but write the
+// normalised b0, b1, b2, a1, a2 straight into an existing second-order object, so they
+// are safe to call from processBlock.
+void designHighPass(Coefficients& coeffs, double sampleRate, float frequency, float quality);
+void designLowPass(Coefficients& coeffs, double sampleRate, float frequency, float quality);
+void designPeak(Coefficients& coeffs, double sampleRate, float frequency, float quality, float gainFactor);
+
+/// One second-order section in the topology-preserving state-variable form the chain
+/// runs. g = tan(pi f / fs) and k = 1 / Q stay well apart from one another even for a
+/// LowCut near DC at 192 kHz, where a biquad's a1 and a2 crowd -2 and 1 and float
+/// rounding moves the pole. The design is done in double and only the results are
+/// stored. The default is a pass-through.
+struct SVFCoefficients
+{
+    /// The solved feedback: 1 / (1 + g (g + k)), then times g, then times g again.
+    float a1 = 1.0f, a2 = 0.0f, a3 = 0.0f;
+
+    /// The output mix of the input, the band-pass and the low-pass.
+    float m0 = 1.0f, m1 = 0.0f, m2 = 0.0f;
+
+    /// What a1..a3 were solved from, for a section retuned every sample.
+    float g = 0.0f, k = 2.0f;
+};
+
+// The same three responses as above, for the chain's sections. The magnitude
+// responses match the biquad designs exactly.
+void designSVFHighPass(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality) noexcept;
+void designSVFLowPass(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality) noexcept;
+void designSVFPeak(SVFCoefficients& coeffs, double sampleRate, float frequency, float quality, float gainFactor) noexcept;
+
+/// Q of section `index` (0-based) when `numSections` biquads are cascaded into one
+/// Butterworth response of order 2 * numSections.
+float getButterworthQ(int numSections, int index);
+
+/// Q for section `index` of a LowCut/HighCut cascade of `numSections` sections. A lone
+/// section keeps the original Q of 1; longer cascades are Butterworth.
+float getCutSectionQ(int numSections, int index);
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    HalfBandFilter.cpp
+    One linear-phase half-band FIR stage, taking a signal down or up by a
+    factor of 2 a whole block at a time. Every other tap is zero, so each
+    rate's samples see only one polyphase branch, and the branch runs as a
+    handful of vector multiply-adds over the block.
+
+  ==============================================================================
+*/
+
+#include "HalfBandFilter.h"
+
+namespace
+{
+    // The zeroth-order modified Bessel function, for the Kaiser window.
+    double besselI0(double x) noexcept
+    {
+        auto sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+void HalfBandFilter::prepare(double sampleRate, double passbandFrequency, double stopbandDecibels, int maximumHighRateSamples)
+{
+    // Kaiser's estimates for the length and window shape. The transition band is
+    // centred on a quarter of the rate, so it runs from the passband edge to its mirror.
+    auto attenuation = -stopbandDecibels;
+    auto transitionWidth = 0.5 - 2.0 * passbandFrequency / sampleRate;
+    jassert(transitionWidth > 0.0);
+
+    auto order = (attenuation - 7.95) / (14.36 * juce::jmax(0.01, transitionWidth));
+    auto beta = attenuation > 50.0 ? 0.1102 * (attenuation - 8.7)
+                                   : 0.5842 * std::pow(attenuation - 21.0, 0.4) + 0.07886 * (attenuation - 21.0);
+
+    // The length estimate is optimistic for short filters, so each candidate is
+    // checked across the stopband and lengthened until it meets the spec. A half-band
+    // ripples equally in both bands, so that covers the passband too.
+    auto estimate = juce::jmax(1, (int)std::ceil(order / 4.0));
+    auto stopbandStart = juce::MathConstants<double>::twoPi * (0.5 - passbandFrequency / sampleRate);
+    auto limit = juce::Decibels::decibelsToGain(stopbandDecibels + 0.5);
+
+    for (auto halfTaps = estimate; halfTaps <= estimate + 4; ++halfTaps)
+    {
+        design(halfTaps, beta);
+
+        if (getPeakGain(stopbandStart, juce::MathConstants<double>::pi) <= limit)
+            break;
+    }
+
+    maxLowRateSamples = (maximumHighRateSamples + 1) / 2;
+    evenPhase.allocate((size_t)(numTaps + maxLowRateSamples), true);
+    oddPhase.allocate((size_t)(numTaps + maxLowRateSamples), true);
+    oddOutput.allocate((size_t)maxLowRateSamples, true);
+}
+
+void HalfBandFilter::design(int halfTaps, double beta)
+{
+    // The full filter has 4 * halfTaps + 1 points, centred on 2 * halfTaps. Only the
+    // odd offsets from the centre are non-zero.
+    numTaps = 2 * halfTaps;
+    taps.allocate((size_t)numTaps, true);
+
+    auto centre = (double)numTaps;
+    auto sum = 0.0;
+
+    for (int j = 0; j < halfTaps; ++j)
+    {
+        auto offset = 2.0 * j + 1.0;
+        auto ratio = offset / centre;
+        auto window = besselI0(beta * std::sqrt(1.0 - ratio * ratio)) / besselI0(beta);
+        auto sinc = (j % 2 == 0 ? 1.0 : -1.0) / (juce::MathConstants<double>::pi * offset);
+        auto tap = sinc * window;
+
+        taps[halfTaps + j] = (float)tap;
+        taps[halfTaps - 1 - j] = (float)tap;
+        sum += 2.0 * tap;
+    }
+
+    // Unity at DC: the centre tap is the other half.
+    for (int t = 0; t < numTaps; ++t)
+        taps[t] = (float)(taps[t] * 0.5 / sum);
+}
+
+double HalfBandFilter::getPeakGain(double fromRadians, double toRadians) const noexcept
+{
+    constexpr int numPoints = 256;
+    auto peak = 0.0;
+
+    // Zero-phase about the centre: 1/2 plus a cosine for each pair of taps.
+    for (int i = 0; i <= numPoints; ++i)
+    {
+        auto w = fromRadians + (toRadians - fromRadians) * i / numPoints;
+        auto gain = 0.5;
+
+        for (int j = 0; j < numTaps / 2; ++j)
+            gain += 2.0 * taps[numTaps / 2 + j] * std::cos(w * (2 * j + 1));
+
+        peak = juce::jmax(peak, std::abs(gain));
+    }
+
+    return peak;
+}
+
+void HalfBandFilter::reset() noexcept
+{
+    evenPhase.clear((size_t)(numTaps + maxLowRateSamples));
+    oddPhase.clear((size_t)(numTaps + maxLowRateSamples));
+}
+
+void HalfBandFilter::decimate(const float* input, float* output, int numInputSamples) noexcept
+{
+    auto numSamples = numInputSamples / 2;
+    jassert(numInputSamples % 2 == 0 && numSamples <= maxLowRateSamples);
+
+    auto* even = evenPhase.get() + numTaps;
+    auto* odd = oddPhase.get() + numTaps;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        even[i] = input[2 * i];
+        odd[i] = input[2 * i + 1];
+    }
+
+    // y[m] = e[m - numTaps / 2] / 2 + sum over t of taps[t] o[m - numTaps + t]
+    juce::FloatVectorOperations::copyWithMultiply(output, even - numTaps / 2, 0.5f, numSamples);
+
+    for (int t = 0; t < numTaps; ++t)
+        juce::FloatVectorOperations::addWithMultiply(output, oddPhase.get() + t, taps[t], numSamples);
+
+    // The history and the block can overlap, so no FloatVectorOperations::copy here.
+    std::memmove(evenPhase, evenPhase.get() + numSamples, (size_t)numTaps * sizeof(float));
+    std::memmove(oddPhase, oddPhase.get() + numSamples, (size_t)numTaps * sizeof(float));
+}
+
+void HalfBandFilter::interpolate(const float* input, float* output, int numInputSamples) noexcept
+{
+    jassert(numInputSamples <= maxLowRateSamples);
+
+    auto* history = evenPhase.get();
+    juce::FloatVectorOperations::copy(history + numTaps, input, numInputSamples);
+
+    // Zero-stuffing halves the level, so both branches are doubled. The even outputs
+    // land on the centre tap and are just the input, one sample later than the odd
+    // outputs need it so the pair can be produced together.
+    juce::FloatVectorOperations::clear(oddOutput, numInputSamples);
+
+    for (int t = 0; t < numTaps; ++t)
+        juce::FloatVectorOperations::addWithMultiply(oddOutput, history + t, 2.0f * taps[t], numInputSamples);
+
+    auto* centre = history + numTaps / 2 - 1;
+
+    for (int i = 0; i < numInputSamples; ++i)
+    {
+        output[2 * i] = centre[i];
+        output[2 * i + 1] = oddOutput[i];
+    }
+
+    std::memmove(history, history + numInputSamples, (size_t)numTaps * sizeof(float));
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    HalfBandFilter.h
+    One linear-phase half-band FIR stage, taking a signal down or up by a
+    factor of 2 a whole block at a time. Every other tap is zero, so each
+    rate's samples see only one polyphase branch, and the branch runs as a
+    handful of vector multiply-adds over the block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class HalfBandFilter
+{
+public:
+    HalfBandFilter() = default;
+
+    /// Designs a Kaiser-windowed half-band for a stage whose high side runs at
+    /// sampleRate. It is flat to passbandFrequency, and stopbandDecibels (a negative
+    /// number, met to within half a dB) down from sampleRate / 2 - passbandFrequency,
+    /// so nothing aliases or images back below the passband edge. Allocates for up to
+    /// maximumHighRateSamples at a time.
+    void prepare(double sampleRate, double passbandFrequency, double stopbandDecibels, int maximumHighRateSamples);
+
+    void reset() noexcept;
+
+    /// Latencies in samples at the high side's rate. Both are whole numbers of
+    /// low-rate samples, so a stage down and back up delays by exactly
+    /// getNumTaps() + 1 low-rate samples.
+    int getDecimationLatency() const noexcept { return numTaps; }
+    int getInterpolationLatency() const noexcept { return numTaps + 2; }
+
+    /// The non-zero taps either side of the centre.
+    int getNumTaps() const noexcept { return numTaps; }
+
+    /// numInputSamples must be even; writes numInputSamples / 2 samples.
+    void decimate(const float* input, float* output, int numInputSamples) noexcept;
+
+    /// Writes numInputSamples * 2 samples.
+    void interpolate(const float* input, float* output, int numInputSamples) noexcept;
+
+private:
+    // The centre tap is always 1/2; taps holds the odd-offset ones from the most to
+    // the least delayed, and is symmetric.
+    juce::HeapBlock<float> taps;
+    int numTaps = 0;
+
+    // Each holds numTaps samples of history in front of the block. Decimating splits
+    // the input into its even and odd samples; interpolating only uses evenPhase.
+    juce::HeapBlock<float> evenPhase, oddPhase, oddOutput;
+    int maxLowRateSamples = 0;
+
+    void design(int halfTaps, double beta);
+    double getPeakGain(double fromRadians, double toRadians) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HalfBandFilter)
+};
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    LinearPhaseCuts.cpp
+    Linear-phase alternative to the IIR LowCut and HighCut: one symmetric FIR with
+    the magnitude response of both cascades, designed on a background thread and
+    run through FFT-partitioned juce::dsp::Convolution.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseCuts.h"
+
+namespace
+{
+    // Long enough to resolve a 48 dB/oct cut at 20 Hz; sets the latency too.
+    constexpr double firSeconds = 0.15;
+
+    // The convolution runs its first partition directly, so it adds no latency of its own.
+    constexpr int convolutionHeadSize = 256;
+
+    constexpr int designPollMilliseconds = 10;
+}
+
+LinearPhaseCuts::LinearPhaseCuts() : juce::Thread("AudioFX linear-phase design")
+{
+}
+
+LinearPhaseCuts::~LinearPhaseCuts()
+{
+    stopThread(2000);
+}
+
+void LinearPhaseCuts::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    stopThread(2000);
+
+    sampleRate = spec.sampleRate;
+    numChannels = (int)spec.numChannels;
+    fftOrder = juce::jmax(8, (int)std::ceil(std::log2(sampleRate * firSeconds)));
+
+    // The FIR has 2^order - 1 taps, centred on tap 2^(order - 1) - 1.
+    latency = (1 << (fftOrder - 1)) - 1;
+
+    convolutions.clear();
+
+    for (int channel = 0; channel < numChannels; channel += 2)
+        convolutions.add(new juce::dsp::Convolution(juce::dsp::Convolution::NonUniform{ convolutionHeadSize }, loadQueue));
+
+    // The FIR is queued before prepare(), which applies pending loads, so it is in
+    // place from the first block. Loaded afterwards, it would arrive some blocks in
+    // and crossfade from a pass-through that ignores the reported latency.
+    designPending = false;
+    loadDesign();
+
+    for (int i = 0; i < convolutions.size(); ++i)
+    {
+        auto pairSpec = spec;
+        pairSpec.numChannels = (juce::uint32)juce::jmin(2, numChannels - i * 2);
+        convolutions.getUnchecked(i)->prepare(pairSpec);
+    }
+
+    startThread();
+}
+
+void LinearPhaseCuts::reset()
+{
+    for (auto* convolution : convolutions)
+        convolution->reset();
+}
+
+void LinearPhaseCuts::setResponse(float lowCut, int numLowCut, float highCut, int numHighCut) noexcept
+{
+    if (lowCut == lowCutFrequency.load() && numLowCut == numLowCutSections.load()
+        && highCut == highCutFrequency.load() && numHighCut == numHighCutSections.load())
+        return;
+
+    lowCutFrequency = lowCut;
+    numLowCutSections = numLowCut;
+    highCutFrequency = highCut;
+    numHighCutSections = numHighCut;
+
+    designPending = true;
+}
+
+void LinearPhaseCuts::process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+{
+    auto& block = context.getOutputBlock();
+    auto numBlockChannels = (int)block.getNumChannels();
+
+    for (int i = 0; i < convolutions.size() && i * 2 < numBlockChannels; ++i)
+    {
+        auto pair = block.getSubsetChannelBlock((size_t)i * 2, (size_t)juce::jmin(2, numBlockChannels - i * 2));
+        convolutions.getUnchecked(i)->process(juce::dsp::ProcessContextReplacing<float>(pair));
+    }
+}
+
+//==============================================================================
+void LinearPhaseCuts::run()
+{
+    while (! threadShouldExit())
+    {
+        // A burst of automation collapses into one design of the latest values.
+        if (designPending.exchange(false))
+            loadDesign();
+
+        wait(designPollMilliseconds);
+    }
+}
+
+void LinearPhaseCuts::loadDesign()
+{
+    auto fir = design();
+
+    for (auto* convolution : convolutions)
+    {
+        juce::AudioBuffer<float> copy(fir);
+        convolution->loadImpulseResponse(std::move(copy), sampleRate, juce::dsp::Convolution::Stereo::no,
+                                         juce::dsp::Convolution::Trim::no, juce::dsp::Convolution::Normalise::no);
+    }
+}
+
+juce::AudioBuffer<float> LinearPhaseCuts::design() const
+{
+    // Frequency sampling: the zero-phase magnitude of the IIR cascades, back to the
+    // time domain, centred and windowed.
+    auto fftSize = 1 << fftOrder;
+    auto numBins = fftSize / 2 + 1;
+
+    std::vector<double> magnitude((size_t)numBins, 1.0);
+    auto section = makeBiquadStorage();
+
+    auto applyCascade = [&](auto designSection, float frequency, int numSections)
+    {
+        for (int i = 0; i < numSections; ++i)
+        {
+            designSection(*section, sampleRate, frequency, getCutSectionQ(numSections, i));
+
+            for (int bin = 0; bin < numBins; ++bin)
+                magnitude[(size_t)bin] *= section->getMagnitudeForFrequency(bin * sampleRate / fftSize, sampleRate);
+        }
+    };
+
+    applyCascade(designHighPass, lowCutFrequency.load(), numLowCutSections.load());
+    applyCascade(designLowPass, highCutFrequency.load(), numHighCutSections.load());
+
+    std::vector<float> spectrum((size_t)fftSize * 2, 0.0f);
+
+    for (int bin = 0; bin < numBins; ++bin)
+        spectrum[(size_t)bin * 2] = (float)magnitude[(size_t)bin];
+
+    juce::dsp::FFT(fftOrder).performRealOnlyInverseTransform(spectrum.data());
+
+    auto numTaps = fftSize - 1;
+    juce::AudioBuffer<float> fir(1, numTaps);
+    auto* taps = fir.getWritePointer(0);
+
+    for (int i = 0; i < numTaps; ++i)
+        taps[i] = spectrum[(size_t)((i - latency + fftSize) % fftSize)];
+
+    juce::dsp::WindowingFunction<float> window((size_t)numTaps, juce::dsp::WindowingFunction<float>::blackman, false);
+    window.multiplyWithWindowingTable(taps, (size_t)numTaps);
+
+    return fir;
+}
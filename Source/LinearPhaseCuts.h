@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    LinearPhaseCuts.h
+    Linear-phase alternative to the IIR LowCut and HighCut: one symmetric FIR with
+    the magnitude response of both cascades, designed on a background thread and
+    run through FFT-partitioned juce::dsp::Convolution.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterDesign.h"
+
+class LinearPhaseCuts : private juce::Thread
+{
+public:
+    LinearPhaseCuts();
+    ~LinearPhaseCuts() override;
+
+    /// Designs and loads the FIR for the last setResponse() values before returning,
+    /// so this allocates and must stay off the audio thread.
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    /// Only records the new response. The design thread notices within a few
+    /// milliseconds and the convolution crossfades into the new FIR, so this is safe
+    /// to call from the audio thread. A cut with no sections is left out.
+    void setResponse(float lowCutFrequency, int numLowCutSections, float highCutFrequency, int numHighCutSections) noexcept;
+
+    /// Delay to the centre tap of the FIR. Depends only on the sample rate.
+    int getLatencySamples() const noexcept { return latency; }
+
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept;
+
+private:
+    // Declared before the convolutions, which post their loads to it.
+    juce::dsp::ConvolutionMessageQueue loadQueue;
+
+    // juce::dsp::Convolution takes at most two channels, so one per channel pair.
+    juce::OwnedArray<juce::dsp::Convolution> convolutions;
+
+    std::atomic<float> lowCutFrequency{ 20.0f }, highCutFrequency{ 20000.0f };
+    std::atomic<int> numLowCutSections{ 1 }, numHighCutSections{ 1 };
+    std::atomic<bool> designPending{ false };
+
+    // Only changed in prepare(), while the design thread is stopped.
+    double sampleRate = 44100.0;
+    int fftOrder = 13, latency = 0, numChannels = 2;
+
+    void run() override;
+    void loadDesign();
+    juce::AudioBuffer<float> design() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseCuts)
+};
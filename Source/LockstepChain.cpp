@@ -0,0 +1,340 @@
+/*
+  ==============================================================================
+
+    LockstepChain.cpp
+    Runs the LowCut, Peak and HighCut stages for every channel at once by
+    packing the channels into the lanes of a juce::dsp::SIMDRegister. Every
+    section is a topology-preserving state-variable filter.
+
+  ==============================================================================
+*/
+
+#include "LockstepChain.h"
+
+void LockstepChain::setCoefficients(const CutCoefficients& lowCut, const SVFCoefficients& peak, const CutCoefficients& highCut) noexcept
+{
+    lowCutCoefficients = &lowCut;
+    peakCoefficients = &peak;
+    highCutCoefficients = &highCut;
+}
+
+void LockstepChain::setNumCutSections(int numLowCut, int numHighCut) noexcept
+{
+    numLowCut = juce::jlimit(1, maxCutSections, numLowCut);
+    numHighCut = juce::jlimit(1, maxCutSections, numHighCut);
+
+    for (auto* group : groups)
+    {
+        for (int i = numLowCutSections; i < numLowCut; ++i)
+            group->lowCut[i].reset();
+
+        for (int i = numHighCutSections; i < numHighCut; ++i)
+            group->highCut[i].reset();
+    }
+
+    numLowCutSections = numLowCut;
+    numHighCutSections = numHighCut;
+}
+
+void LockstepChain::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    auto numGroups = ((size_t)spec.numChannels + lanes - 1) / lanes;
+
+    groups.clear();
+
+    for (size_t i = 0; i < numGroups; ++i)
+        groups.add(new LaneGroup());
+
+    interleaved = juce::dsp::AudioBlock<SIMDFloat>(interleavedData, numGroups, spec.maximumBlockSize);
+    interleaved.clear();
+
+    fadeInput = juce::dsp::AudioBlock<SIMDFloat>(fadeInputData, numGroups, spec.maximumBlockSize);
+
+    for (auto& bypass : bypasses)
+        bypass.prepare(spec.sampleRate, (int)spec.maximumBlockSize);
+}
+
+void LockstepChain::reset()
+{
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        resetStage((Stage)stage);
+        bypasses[stage].reset();
+    }
+
+    interleaved.clear();
+}
+
+void LockstepChain::resetStage(Stage stage) noexcept
+{
+    for (auto* group : groups)
+    {
+        for (int i = 0; i < maxCutSections; ++i)
+        {
+            if (stage == lowCutStage)
+                group->lowCut[i].reset();
+            else if (stage == highCutStage)
+                group->highCut[i].reset();
+        }
+
+        if (stage == peakStage)
+            group->peak.reset();
+    }
+}
+
+void LockstepChain::process(const juce::dsp::ProcessContextReplacing<float>& context, RenderPool* pool) noexcept
+{
+    auto& block = context.getOutputBlock();
+    auto numSamples = block.getNumSamples();
+
+    jassert(numSamples <= interleaved.getNumSamples());
+    jassert(block.getNumChannels() <= (size_t)groups.size() * lanes);
+
+    // Tuning only ever lasts one call.
+    const float* tunings[numStages];
+    std::copy(std::begin(tuning), std::end(tuning), tunings);
+    std::fill(std::begin(tuning), std::end(tuning), nullptr);
+
+    if (! (isStageRunning(lowCutStage) || isStageRunning(peakStage) || isStageRunning(highCutStage)))
+        return;
+
+    // Fades advance once per block, so every lane group gets the same gains.
+    const float* fadeGains[numStages] = {};
+
+    for (int stage = 0; stage < numStages; ++stage)
+        if (stageActive[stage] && bypasses[stage].isFading())
+            fadeGains[stage] = bypasses[stage].getNextGains((int)numSamples);
+
+    forEachTask(pool, groups.size(), [&](int groupIndex)
+    {
+        auto g = (size_t)groupIndex;
+        auto* group = groups.getUnchecked(groupIndex);
+
+        interleave(block, g);
+
+        auto* samples = interleaved.getChannelPointer(g);
+
+        auto runStage = [&](Stage stage, auto&& processStage)
+        {
+            // A fade's last block has already left the bypass off, so a fading stage
+            // runs whatever isStageRunning() says.
+            if (fadeGains[stage] == nullptr)
+            {
+                if (isStageRunning(stage))
+                    processStage();
+
+                return;
+            }
+
+            auto* input = fadeInput.getChannelPointer(g);
+
+            std::copy(samples, samples + numSamples, input);
+            processStage();
+            StageBypass::crossfade(samples, input, fadeGains[stage], numSamples);
+        };
+
+        auto processSection = [&](Section& section, const SVFCoefficients& coeffs, Stage stage)
+        {
+            if (tunings[stage] != nullptr)
+                section.process(coeffs, tunings[stage], samples, numSamples);
+            else
+                section.process(coeffs, samples, numSamples);
+        };
+
+        runStage(lowCutStage, [&]
+        {
+            for (int i = 0; i < numLowCutSections; ++i)
+                processSection(group->lowCut[i], (*lowCutCoefficients)[(size_t)i], lowCutStage);
+        });
+
+        runStage(peakStage, [&] { processSection(group->peak, *peakCoefficients, peakStage); });
+
+        runStage(highCutStage, [&]
+        {
+            for (int i = 0; i < numHighCutSections; ++i)
+                processSection(group->highCut[i], (*highCutCoefficients)[(size_t)i], highCutStage);
+        });
+
+        deinterleave(block, g);
+    });
+
+    // A stage that just finished fading out comes back from silence.
+    for (int stage = 0; stage < numStages; ++stage)
+        if (fadeGains[stage] != nullptr && bypasses[stage].isOff())
+            resetStage((Stage)stage);
+}
+
+void LockstepChain::Section::process(const SVFCoefficients& coeffs, SIMDFloat* samples, size_t numSamples) noexcept
+{
+    // The coefficients are read once per block; designing new ones in place between
+    // blocks retunes the section without touching its state.
+    auto a1 = SIMDFloat::expand(coeffs.a1), a2 = SIMDFloat::expand(coeffs.a2), a3 = SIMDFloat::expand(coeffs.a3);
+    auto m0 = SIMDFloat::expand(coeffs.m0), m1 = SIMDFloat::expand(coeffs.m1), m2 = SIMDFloat::expand(coeffs.m2);
+    auto s1 = ic1eq, s2 = ic2eq;
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        auto v0 = samples[i];
+        auto v3 = v0 - s2;
+        auto v1 = a1 * s1 + a2 * v3;
+        auto v2 = s2 + a2 * s1 + a3 * v3;
+
+        s1 = v1 + v1 - s1;
+        s2 = v2 + v2 - s2;
+        samples[i] = m0 * v0 + m1 * v1 + m2 * v2;
+    }
+
+    ic1eq = s1;
+    ic2eq = s2;
+}
+
+void LockstepChain::Section::process(const SVFCoefficients& coeffs, const float* g, SIMDFloat* samples, size_t numSamples) noexcept
+{
+    // Every lane shares the tuning, so the feedback is solved once per sample in
+    // scalar code and broadcast; SIMDRegister has no division anyway.
+    auto k = coeffs.k;
+    auto m0 = SIMDFloat::expand(coeffs.m0), m1 = SIMDFloat::expand(coeffs.m1), m2 = SIMDFloat::expand(coeffs.m2);
+    auto s1 = ic1eq, s2 = ic2eq;
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        auto a1 = 1.0f / (1.0f + g[i] * (g[i] + k));
+        auto a2 = g[i] * a1;
+        auto a3 = g[i] * a2;
+
+        auto v0 = samples[i];
+        auto v3 = v0 - s2;
+        auto v1 = s1 * a1 + v3 * a2;
+        auto v2 = s2 + s1 * a2 + v3 * a3;
+
+        s1 = v1 + v1 - s1;
+        s2 = v2 + v2 - s2;
+        samples[i] = m0 * v0 + m1 * v1 + m2 * v2;
+    }
+
+    ic1eq = s1;
+    ic2eq = s2;
+}
+
+void LockstepChain::interleave(const juce::dsp::AudioBlock<float>& block, size_t group) noexcept
+{
+    auto* frames = reinterpret_cast<float*>(interleaved.getChannelPointer(group));
+    auto numSamples = block.getNumSamples();
+    auto firstChannel = group * lanes;
+    auto numActive = juce::jmin(lanes, block.getNumChannels() - firstChannel);
+    size_t done = 0;
+
+    if (numActive == lanes)
+    {
+        const float* src[lanes];
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+            src[lane] = block.getChannelPointer(firstChannel + lane);
+
+        done = transposeIn(src, frames, numSamples);
+    }
+
+    for (size_t lane = 0; lane < numActive; ++lane)
+    {
+        auto* src = block.getChannelPointer(firstChannel + lane);
+
+        for (size_t i = done; i < numSamples; ++i)
+            frames[i * lanes + lane] = src[i];
+    }
+}
+
+void LockstepChain::deinterleave(juce::dsp::AudioBlock<float>& block, size_t group) noexcept
+{
+    auto* frames = reinterpret_cast<const float*>(interleaved.getChannelPointer(group));
+    auto numSamples = block.getNumSamples();
+    auto firstChannel = group * lanes;
+    auto numActive = juce::jmin(lanes, block.getNumChannels() - firstChannel);
+    size_t done = 0;
+
+    if (numActive == lanes)
+    {
+        float* dst[lanes];
+
+        for (size_t lane = 0; lane < lanes; ++lane)
+            dst[lane] = block.getChannelPointer(firstChannel + lane);
+
+        done = transposeOut(frames, dst, numSamples);
+    }
+
+    for (size_t lane = 0; lane < numActive; ++lane)
+    {
+        auto* dst = block.getChannelPointer(firstChannel + lane);
+
+        for (size_t i = done; i < numSamples; ++i)
+            dst[i] = frames[i * lanes + lane];
+    }
+}
+
+//==============================================================================
+// A full group is a 4x4 transpose per four samples, which both instruction sets do
+// in registers. Anything else (partial groups, other lane counts, the last few
+// samples) goes through the scalar loops above; these return how far they got.
+size_t LockstepChain::transposeIn(const float* const* src, float* frames, size_t numSamples) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS || (JUCE_USE_ARM_NEON && defined (__aarch64__))
+    if constexpr (lanes == 4)
+    {
+        size_t i = 0;
+
+        for (; i + 4 <= numSamples; i += 4, frames += 16)
+        {
+           #if JUCE_USE_SSE_INTRINSICS
+            auto r0 = _mm_loadu_ps(src[0] + i), r1 = _mm_loadu_ps(src[1] + i);
+            auto r2 = _mm_loadu_ps(src[2] + i), r3 = _mm_loadu_ps(src[3] + i);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(frames, r0);
+            _mm_storeu_ps(frames + 4, r1);
+            _mm_storeu_ps(frames + 8, r2);
+            _mm_storeu_ps(frames + 12, r3);
+           #else
+            float32x4x4_t channels { { vld1q_f32(src[0] + i), vld1q_f32(src[1] + i), vld1q_f32(src[2] + i), vld1q_f32(src[3] + i) } };
+            vst4q_f32(frames, channels);
+           #endif
+        }
+
+        return i;
+    }
+   #endif
+
+    juce::ignoreUnused(src, frames, numSamples);
+    return 0;
+}
+
+size_t LockstepChain::transposeOut(const float* frames, float* const* dst, size_t numSamples) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS || (JUCE_USE_ARM_NEON && defined (__aarch64__))
+    if constexpr (lanes == 4)
+    {
+        size_t i = 0;
+
+        for (; i + 4 <= numSamples; i += 4, frames += 16)
+        {
+           #if JUCE_USE_SSE_INTRINSICS
+            auto r0 = _mm_loadu_ps(frames), r1 = _mm_loadu_ps(frames + 4);
+            auto r2 = _mm_loadu_ps(frames + 8), r3 = _mm_loadu_ps(frames + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dst[0] + i, r0);
+            _mm_storeu_ps(dst[1] + i, r1);
+            _mm_storeu_ps(dst[2] + i, r2);
+            _mm_storeu_ps(dst[3] + i, r3);
+           #else
+            auto channels = vld4q_f32(frames);
+            vst1q_f32(dst[0] + i, channels.val[0]);
+            vst1q_f32(dst[1] + i, channels.val[1]);
+            vst1q_f32(dst[2] + i, channels.val[2]);
+            vst1q_f32(dst[3] + i, channels.val[3]);
+           #endif
+        }
+
+        return i;
+    }
+   #endif
+
+    juce::ignoreUnused(frames, dst, numSamples);
+    return 0;
+}
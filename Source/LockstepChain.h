@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    LockstepChain.h
+    Runs the LowCut, Peak and HighCut stages for every channel at once by
+    packing the channels into the lanes of a juce::dsp::SIMDRegister. Every
+    section is a topology-preserving state-variable filter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterDesign.h"
+#include "StageBypass.h"
+#include "RenderPool.h"
+
+class LockstepChain
+{
+public:
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+
+    /// Number of channels that share one register.
+    static constexpr size_t lanes = SIMDFloat::SIMDNumElements;
+
+    /// LowCut and HighCut are each a cascade of up to this many second-order
+    /// sections (12 dB/oct apiece).
+    static constexpr int maxCutSections = 4;
+
+    using CutCoefficients = std::array<SVFCoefficients, maxCutSections>;
+
+    LockstepChain() = default;
+
+    enum Stage
+    {
+        lowCutStage, peakStage, highCutStage, numStages
+    };
+
+    /// The chain keeps pointers to these and never copies them, so designing new
+    /// coefficients in place is enough to retune every lane.
+    void setCoefficients(const CutCoefficients& lowCut, const SVFCoefficients& peak, const CutCoefficients& highCut) noexcept;
+
+    /// How many sections of each cut run. Sections that come back into use start
+    /// from silence rather than from whatever they held when they were dropped.
+    void setNumCutSections(int numLowCut, int numHighCut) noexcept;
+    int getNumLowCutSections() const noexcept { return numLowCutSections; }
+    int getNumHighCutSections() const noexcept { return numHighCutSections; }
+
+    /// Inactive stages are skipped and their filter state is left untouched. With no
+    /// stage active the block isn't even interleaved.
+    void setStageActive(Stage stage, bool shouldBeActive) noexcept { stageActive[stage] = shouldBeActive; }
+    bool isStageActive(Stage stage) const noexcept { return stageActive[stage]; }
+
+    /// The user-facing bypass: the stage fades out over StageBypass::fadeSeconds, is
+    /// then skipped and cleared, and fades back in from silence.
+    void setStageBypassed(Stage stage, bool shouldBeBypassed) noexcept { bypasses[stage].setBypassed(shouldBeBypassed); }
+
+    /// Retunes a stage every sample of the next process() call only: g is one
+    /// tan(pi f / fs) per sample, used in place of the designed one. The sections keep
+    /// their designed damping and output mix. nullptr goes back to the design.
+    void setTuning(Stage stage, const float* g) noexcept { tuning[stage] = g; }
+
+    /// spec.numChannels is the total channel count; channels are grouped into
+    /// registers of `lanes` and any spare lanes in the last register stay silent.
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    /// With a pool, the lane groups are filtered in parallel. They share nothing but
+    /// the coefficients, so the output doesn't change.
+    void process(const juce::dsp::ProcessContextReplacing<float>& context, RenderPool* pool = nullptr) noexcept;
+
+private:
+    /// The two integrator states of one section, a lane per channel.
+    struct Section
+    {
+        SIMDFloat ic1eq = SIMDFloat::expand(0.0f), ic2eq = SIMDFloat::expand(0.0f);
+
+        void reset() noexcept { ic1eq = ic2eq = SIMDFloat::expand(0.0f); }
+        void process(const SVFCoefficients& coeffs, SIMDFloat* samples, size_t numSamples) noexcept;
+        void process(const SVFCoefficients& coeffs, const float* g, SIMDFloat* samples, size_t numSamples) noexcept;
+    };
+
+    struct LaneGroup
+    {
+        Section lowCut[maxCutSections], peak, highCut[maxCutSections];
+    };
+
+    juce::OwnedArray<LaneGroup> groups;
+    bool stageActive[numStages] = { true, true, true };
+    StageBypass bypasses[numStages];
+    int numLowCutSections = 1, numHighCutSections = 1;
+
+    // Until setCoefficients() is called every section passes its input through.
+    CutCoefficients passThrough;
+    SVFCoefficients peakPassThrough;
+    const CutCoefficients* lowCutCoefficients = &passThrough;
+    const CutCoefficients* highCutCoefficients = &passThrough;
+    const SVFCoefficients* peakCoefficients = &peakPassThrough;
+    const float* tuning[numStages] = {};
+
+    // One interleaved "channel" per lane group, each sample being a full register.
+    juce::HeapBlock<char> interleavedData;
+    juce::dsp::AudioBlock<SIMDFloat> interleaved;
+
+    // A fading stage's input, kept to crossfade against; one channel per lane group.
+    juce::HeapBlock<char> fadeInputData;
+    juce::dsp::AudioBlock<SIMDFloat> fadeInput;
+
+    bool isStageRunning(Stage stage) const noexcept { return stageActive[stage] && ! bypasses[stage].isOff(); }
+    void resetStage(Stage stage) noexcept;
+
+    void interleave(const juce::dsp::AudioBlock<float>& block, size_t group) noexcept;
+    void deinterleave(juce::dsp::AudioBlock<float>& block, size_t group) noexcept;
+
+    static size_t transposeIn(const float* const* src, float* frames, size_t numSamples) noexcept;
+    static size_t transposeOut(const float* frames, float* const* dst, size_t numSamples) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LockstepChain)
+};
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    MeterView.cpp
+    Input and output level meters, waveshaper gain reduction and CPU load,
+    drained from the processor's telemetry queue on a timer.
+
+  ==============================================================================
+*/
+
+#include "MeterView.h"
+
+MeterView::MeterView(AudioFXAudioProcessor& processor) : audioProcessor(processor)
+{
+    setOpaque(false);
+    audioProcessor.setMeteringEnabled(true);
+    startTimerHz(refreshRateHz);
+}
+
+MeterView::~MeterView()
+{
+    stopTimer();
+    audioProcessor.setMeteringEnabled(false);
+}
+
+void MeterView::timerCallback()
+{
+    // Levels fall at a fixed rate per tick and jump up to anything louder that
+    // arrived since the last one; everything queued is read so nothing piles up.
+    auto release = juce::Decibels::decibelsToGain(-releaseDecibelsPerSecond / (float)refreshRateHz);
+
+    for (int ch = 0; ch < TelemetryFrame::maxChannels; ++ch)
+    {
+        inputPeak[ch] *= release;
+        inputRms[ch] *= release;
+        outputPeak[ch] *= release;
+        outputRms[ch] *= release;
+    }
+
+    gainReduction = juce::jmin(0.0f, gainReduction + releaseDecibelsPerSecond / (float)refreshRateHz);
+
+    auto newCpuLoad = 0.0f;
+    auto received = false;
+
+    while (audioProcessor.getTelemetry().pop(frame))
+    {
+        received = true;
+        numChannels = frame.numChannels;
+
+        for (int ch = 0; ch < frame.numChannels; ++ch)
+        {
+            inputPeak[ch] = juce::jmax(inputPeak[ch], frame.inputPeak[ch]);
+            inputRms[ch] = juce::jmax(inputRms[ch], frame.inputRms[ch]);
+            outputPeak[ch] = juce::jmax(outputPeak[ch], frame.outputPeak[ch]);
+            outputRms[ch] = juce::jmax(outputRms[ch], frame.outputRms[ch]);
+        }
+
+        gainReduction = juce::jmin(gainReduction, frame.gainReductionDecibels);
+        newCpuLoad = juce::jmax(newCpuLoad, frame.cpuLoad);
+    }
+
+    // With transport stopped the host may not call processBlock at all; let the
+    // bars fall rather than freeze.
+    cpuLoad = received ? newCpuLoad : cpuLoad * release;
+    repaint();
+}
+
+void MeterView::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat().reduced(4.0f);
+    auto labelHeight = 14.0f;
+    auto gap = 8.0f;
+
+    // Input meters | output meters | gain reduction | CPU
+    auto sectionWidth = (bounds.getWidth() - gap * 3.0f) / 5.0f;
+    auto inputArea = bounds.removeFromLeft(sectionWidth * 2.0f);
+    bounds.removeFromLeft(gap);
+    auto outputArea = bounds.removeFromLeft(sectionWidth * 2.0f);
+    bounds.removeFromLeft(gap);
+    auto reductionArea = bounds.removeFromLeft((bounds.getWidth() - gap) * 0.5f);
+    bounds.removeFromLeft(gap);
+    auto cpuArea = bounds;
+
+    g.setColour(juce::Colours::white);
+    g.setFont(12.0f);
+
+    g.drawText("IN", inputArea.removeFromBottom(labelHeight), juce::Justification::centred, false);
+    g.drawText("OUT", outputArea.removeFromBottom(labelHeight), juce::Justification::centred, false);
+    g.drawText("GR", reductionArea.removeFromBottom(labelHeight), juce::Justification::centred, false);
+    g.drawText("CPU", cpuArea.removeFromBottom(labelHeight), juce::Justification::centred, false);
+
+    drawLevels(g, inputArea, inputPeak, inputRms);
+    drawLevels(g, outputArea, outputPeak, outputRms);
+
+    drawBar(g, reductionArea, juce::jlimit(0.0f, 1.0f, gainReduction / floorDecibels), juce::Colours::orange, true);
+    drawBar(g, cpuArea, juce::jlimit(0.0f, 1.0f, cpuLoad), cpuLoad < 0.75f ? juce::Colours::lightblue : juce::Colours::red, false);
+}
+
+void MeterView::drawLevels(juce::Graphics& g, juce::Rectangle<float> area, const float* peaks, const float* rms) const
+{
+    if (numChannels == 0)
+        return;
+
+    auto barWidth = area.getWidth() / (float)numChannels;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto bar = area.removeFromLeft(barWidth).reduced(1.0f, 0.0f);
+        drawBar(g, bar, toProportion(rms[ch]), juce::Colours::limegreen, false);
+
+        // The peak is a thin line over the RMS bar.
+        auto peakY = bar.getBottom() - bar.getHeight() * toProportion(peaks[ch]);
+        g.setColour(peaks[ch] >= 1.0f ? juce::Colours::red : juce::Colours::yellow);
+        g.fillRect(bar.getX(), peakY - 1.0f, bar.getWidth(), 2.0f);
+    }
+}
+
+void MeterView::drawBar(juce::Graphics& g, juce::Rectangle<float> area, float proportion, juce::Colour colour, bool fromTop) const
+{
+    g.setColour(juce::Colours::black.withAlpha(0.5f));
+    g.fillRect(area);
+
+    auto height = area.getHeight() * proportion;
+    g.setColour(colour);
+    g.fillRect(fromTop ? area.removeFromTop(height) : area.removeFromBottom(height));
+}
+
+float MeterView::toProportion(float gain) noexcept
+{
+    auto decibels = juce::Decibels::gainToDecibels(gain, floorDecibels);
+    return juce::jlimit(0.0f, 1.0f, 1.0f - decibels / floorDecibels);
+}
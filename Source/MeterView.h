@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    MeterView.h
+    Input and output level meters, waveshaper gain reduction and CPU load,
+    drained from the processor's telemetry queue on a timer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class MeterView : public juce::Component,
+                  private juce::Timer
+{
+public:
+    /// Turns the processor's metering on for as long as the view exists.
+    explicit MeterView(AudioFXAudioProcessor& processor);
+    ~MeterView() override;
+
+    void paint(juce::Graphics& g) override;
+
+    static constexpr int refreshRateHz = 30;
+
+    /// Bars span this range; anything quieter reads as empty.
+    static constexpr float floorDecibels = -60.0f;
+
+    /// How fast a bar falls once the level drops.
+    static constexpr float releaseDecibelsPerSecond = 24.0f;
+
+private:
+    AudioFXAudioProcessor& audioProcessor;
+
+    // What's on screen, after ballistics. Updated in place, so draining never allocates.
+    int numChannels = 0;
+    float inputPeak[TelemetryFrame::maxChannels] = {}, inputRms[TelemetryFrame::maxChannels] = {};
+    float outputPeak[TelemetryFrame::maxChannels] = {}, outputRms[TelemetryFrame::maxChannels] = {};
+    float gainReduction = 0.0f, cpuLoad = 0.0f;
+
+    TelemetryFrame frame;
+
+    void timerCallback() override;
+
+    void drawLevels(juce::Graphics& g, juce::Rectangle<float> area, const float* peaks, const float* rms) const;
+    void drawBar(juce::Graphics& g, juce::Rectangle<float> area, float proportion, juce::Colour colour, bool fromTop) const;
+    static float toProportion(float gain) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterView)
+};
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.cpp
+    An LFO and an envelope follower routed, each with its own depth, to the
+    LowCut, Peak and HighCut frequencies and to the WaveShape drive. Both
+    sources run per sample, and each target gets one summed signal per block.
+
+  ==============================================================================
+*/
+
+#include "ModulationMatrix.h"
+
+void ModulationMatrix::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    sourceSignals.setSize(numSources, maximumBlockSize);
+    targetSignals.setSize(numTargets, maximumBlockSize);
+
+    updateCoefficients();
+    reset();
+}
+
+void ModulationMatrix::reset() noexcept
+{
+    phase = 0.0f;
+    envelope = 0.0f;
+}
+
+void ModulationMatrix::setLfoRate(float hertz) noexcept
+{
+    lfoRate = hertz;
+    updateCoefficients();
+}
+
+void ModulationMatrix::setEnvelopeTimes(float attack, float release) noexcept
+{
+    attackMilliseconds = attack;
+    releaseMilliseconds = release;
+    updateCoefficients();
+}
+
+void ModulationMatrix::updateCoefficients() noexcept
+{
+    auto onePole = [this](float milliseconds)
+    {
+        return (float)(1.0 - std::exp(-1000.0 / (juce::jmax(0.01f, milliseconds) * sampleRate)));
+    };
+
+    phaseIncrement = (float)(juce::MathConstants<double>::twoPi * lfoRate / sampleRate);
+    attackCoefficient = onePole(attackMilliseconds);
+    releaseCoefficient = onePole(releaseMilliseconds);
+}
+
+bool ModulationMatrix::isModulated(Target target) const noexcept
+{
+    for (int source = 0; source < numSources; ++source)
+        if (depths[source][target] != 0.0f)
+            return true;
+
+    return false;
+}
+
+bool ModulationMatrix::isActive() const noexcept
+{
+    for (int target = 0; target < numTargets; ++target)
+        if (isModulated((Target)target))
+            return true;
+
+    return false;
+}
+
+void ModulationMatrix::process(const juce::dsp::AudioBlock<float>& input) noexcept
+{
+    auto numSamples = (int)input.getNumSamples();
+    jassert(numSamples <= sourceSignals.getNumSamples());
+
+    // The phase stays within -pi..pi, where the fast sine holds.
+    auto* lfo = sourceSignals.getWritePointer(lfoSource);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        lfo[i] = juce::dsp::FastMathApproximations::sin(phase);
+        phase += phaseIncrement;
+
+        if (phase >= juce::MathConstants<float>::pi)
+            phase -= juce::MathConstants<float>::twoPi;
+    }
+
+    auto* follower = sourceSignals.getWritePointer(envelopeSource);
+    auto level = envelope;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto peak = 0.0f;
+
+        for (size_t ch = 0; ch < input.getNumChannels(); ++ch)
+            peak = juce::jmax(peak, std::abs(input.getChannelPointer(ch)[i]));
+
+        level += (peak > level ? attackCoefficient : releaseCoefficient) * (peak - level);
+        follower[i] = juce::jmin(1.0f, level);
+    }
+
+    envelope = level;
+
+    for (int target = 0; target < numTargets; ++target)
+    {
+        if (! isModulated((Target)target))
+            continue;
+
+        auto* signal = targetSignals.getWritePointer(target);
+        juce::FloatVectorOperations::copyWithMultiply(signal, lfo, depths[lfoSource][target], numSamples);
+        juce::FloatVectorOperations::addWithMultiply(signal, follower, depths[envelopeSource][target], numSamples);
+        juce::FloatVectorOperations::clip(signal, signal, -1.0f, 1.0f, numSamples);
+    }
+}
+
+const float* ModulationMatrix::getSignal(Target target) const noexcept
+{
+    return isModulated(target) ? targetSignals.getReadPointer(target) : nullptr;
+}
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+    An LFO and an envelope follower routed, each with its own depth, to the
+    LowCut, Peak and HighCut frequencies and to the WaveShape drive. Both
+    sources run per sample, and each target gets one summed signal per block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ModulationMatrix
+{
+public:
+    enum Source
+    {
+        lfoSource, envelopeSource, numSources
+    };
+
+    enum Target
+    {
+        lowCutTarget, peakTarget, highCutTarget, gainTarget, numTargets
+    };
+
+    ModulationMatrix() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /// Restarts the LFO and lets the envelope fall to zero.
+    void reset() noexcept;
+
+    /// A sine from 0 to 1 and back down to -1.
+    void setLfoRate(float hertz) noexcept;
+
+    /// The envelope follower's one-pole times, tracking the peak across channels.
+    void setEnvelopeTimes(float attackMilliseconds, float releaseMilliseconds) noexcept;
+
+    /// depth is -1..1; 0 routes nothing.
+    void setDepth(Source source, Target target, float depth) noexcept { depths[source][target] = depth; }
+
+    bool isModulated(Target target) const noexcept;
+    bool isActive() const noexcept;
+
+    /// Runs both sources over the block; input drives the envelope follower.
+    void process(const juce::dsp::AudioBlock<float>& input) noexcept;
+
+    /// Per sample of the block process() last ran over: each source times its depth,
+    /// summed and clamped to -1..1. nullptr for a target with nothing routed to it.
+    const float* getSignal(Target target) const noexcept;
+
+private:
+    double sampleRate = 44100.0;
+    float depths[numSources][numTargets] = {};
+
+    float phase = 0.0f, phaseIncrement = 0.0f;
+    float envelope = 0.0f, attackCoefficient = 1.0f, releaseCoefficient = 1.0f;
+    float lfoRate = 1.0f, attackMilliseconds = 5.0f, releaseMilliseconds = 100.0f;
+
+    // One channel per source, then one per target.
+    juce::AudioBuffer<float> sourceSignals, targetSignals;
+
+    void updateCoefficients() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulationMatrix)
+};
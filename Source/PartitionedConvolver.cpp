@@ -0,0 +1,394 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.cpp
+    Zero-latency, non-uniformly partitioned convolution for long impulse
+    responses. The first taps run in direct form; the rest are split into FFT
+    partitions that grow 8x per stage, so short blocks stay cheap and a
+    multi-second tail costs a handful of large FFTs. The large stages spread
+    that work evenly over a block period instead of doing it all at once.
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+namespace
+{
+    int getSpectrumSize(int blockSize) noexcept
+    {
+        return (blockSize + 1) * 2;
+    }
+
+    int getFFTOrder(int blockSize) noexcept
+    {
+        // Overlap-save over two blocks.
+        return juce::roundToInt(std::log2(blockSize * 2));
+    }
+
+    // juce::dsp::FFT interleaves real and imaginary parts; the multiply-adds want
+    // them in separate runs so they vectorise.
+    void deinterleave(const float* interleaved, float* split, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            split[bin] = interleaved[bin * 2];
+            split[numBins + bin] = interleaved[bin * 2 + 1];
+        }
+    }
+
+    void interleave(const float* split, float* interleaved, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            interleaved[bin * 2] = split[bin];
+            interleaved[bin * 2 + 1] = split[numBins + bin];
+        }
+    }
+
+    // Fixed-size header in front of the float data, padded so the data stays aligned.
+    struct CacheHeader
+    {
+        char magic[8];
+        juce::uint32 version;
+        juce::int32 numChannels, length, reserved;
+        juce::int64 key;
+    };
+
+    constexpr size_t cacheHeaderBytes = 64;
+    // Bumped whenever an entry for the same key would hold different spectra.
+    constexpr juce::uint32 cacheVersion = 3;
+    const char cacheMagic[8] = { 'A', 'F', 'X', 'I', 'R', 'P', 'T', 'N' };
+
+    static_assert(sizeof(CacheHeader) <= cacheHeaderBytes, "header must fit its padding");
+}
+
+//==============================================================================
+PartitionedIR::PartitionedIR(int channels, int numSamples)
+    : numChannels(channels), length(numSamples)
+{
+    numFloats = (size_t)(numChannels * headSize);
+
+    int blockSize = headSize, offset = headSize;
+
+    while (offset < length)
+    {
+        // Each stage reaches as far as two blocks of the next, where that deferred
+        // stage starts.
+        auto isLast = blockSize == maxBlockSize;
+        auto end = isLast ? length : juce::jmin(length, blockSize * growth * 2);
+        auto numPartitions = (end - offset + blockSize - 1) / blockSize;
+
+        jassert(offset == (blockSize == headSize ? blockSize : blockSize * 2));
+
+        stages.push_back({ blockSize, numPartitions, offset });
+        stageStarts.push_back(numFloats);
+        numFloats += (size_t)(numChannels * numPartitions * getSpectrumSize(blockSize));
+
+        offset += numPartitions * blockSize;
+
+        if (! isLast)
+            blockSize *= growth;
+    }
+}
+
+std::unique_ptr<PartitionedIR> PartitionedIR::build(const juce::AudioBuffer<float>& impulse)
+{
+    std::unique_ptr<PartitionedIR> ir(new PartitionedIR(impulse.getNumChannels(), impulse.getNumSamples()));
+    ir->ownedData.assign(ir->numFloats, 0.0f);
+    ir->data = ir->ownedData.data();
+
+    auto* out = ir->getWritableData();
+
+    for (int channel = 0; channel < ir->numChannels; ++channel)
+    {
+        auto* samples = impulse.getReadPointer(channel);
+        auto* head = out + channel * headSize;
+
+        for (int i = 0; i < juce::jmin(headSize, ir->length); ++i)
+            head[headSize - 1 - i] = samples[i];
+    }
+
+    for (size_t s = 0; s < ir->stages.size(); ++s)
+    {
+        auto& stage = ir->stages[s];
+        auto spectrumSize = getSpectrumSize(stage.blockSize);
+
+        juce::dsp::FFT fft(getFFTOrder(stage.blockSize));
+        std::vector<float> scratch((size_t)stage.blockSize * 4);
+
+        for (int channel = 0; channel < ir->numChannels; ++channel)
+        {
+            auto* samples = impulse.getReadPointer(channel);
+
+            for (int p = 0; p < stage.numPartitions; ++p)
+            {
+                auto start = stage.offset + p * stage.blockSize;
+                auto numToCopy = juce::jmin(stage.blockSize, ir->length - start);
+
+                std::fill(scratch.begin(), scratch.end(), 0.0f);
+                std::copy(samples + start, samples + start + numToCopy, scratch.begin());
+                fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+                auto* spectrum = out + ir->stageStarts[s] + (size_t)((channel * stage.numPartitions + p) * spectrumSize);
+                deinterleave(scratch.data(), spectrum, stage.blockSize + 1);
+            }
+        }
+    }
+
+    return ir;
+}
+
+std::unique_ptr<PartitionedIR> PartitionedIR::loadFromCache(const juce::File& file, juce::int64 key)
+{
+    juce::FileInputStream stream(file);
+
+    if (! stream.openedOk())
+        return nullptr;
+
+    char paddedHeader[cacheHeaderBytes];
+    CacheHeader header;
+
+    if (stream.read(paddedHeader, (int)cacheHeaderBytes) != (int)cacheHeaderBytes)
+        return nullptr;
+
+    std::memcpy(&header, paddedHeader, sizeof(header));
+
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion
+        || header.key != key || header.numChannels <= 0 || header.length <= 0)
+        return nullptr;
+
+    std::unique_ptr<PartitionedIR> ir(new PartitionedIR(header.numChannels, header.length));
+    auto numBytes = ir->numFloats * sizeof(float);
+
+    if ((size_t)stream.getTotalLength() != cacheHeaderBytes + numBytes)
+        return nullptr;
+
+    // Read into memory here rather than mapped: the audio thread would otherwise take
+    // the page faults, and maybe the disk reads, the first time it touches a partition.
+    ir->ownedData.resize(ir->numFloats);
+    ir->data = ir->ownedData.data();
+
+    if (stream.read(ir->ownedData.data(), (int)numBytes) != (int)numBytes)
+        return nullptr;
+
+    return ir;
+}
+
+bool PartitionedIR::writeToCache(const juce::File& file, juce::int64 key) const
+{
+    CacheHeader header {};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.numChannels = numChannels;
+    header.length = length;
+    header.key = key;
+
+    char paddedHeader[cacheHeaderBytes] = {};
+    std::memcpy(paddedHeader, &header, sizeof(header));
+
+    // Written beside the target and moved into place, so another instance mapping
+    // the same key never sees half a file.
+    juce::TemporaryFile temp(file);
+
+    {
+        juce::FileOutputStream stream(temp.getFile());
+
+        if (! stream.openedOk()
+            || ! stream.write(paddedHeader, cacheHeaderBytes)
+            || ! stream.write(data, numFloats * sizeof(float)))
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+const float* PartitionedIR::getReversedHead(int channel) const noexcept
+{
+    return data + channel * headSize;
+}
+
+const float* PartitionedIR::getSpectrum(int channel, int stage, int partition) const noexcept
+{
+    auto& layout = stages[(size_t)stage];
+    return data + stageStarts[(size_t)stage] + (size_t)((channel * layout.numPartitions + partition) * getSpectrumSize(layout.blockSize));
+}
+
+//==============================================================================
+PartitionedConvolver::StageState::StageState(const PartitionedIR::Stage& layout)
+    : blockSize(layout.blockSize),
+      numPartitions(layout.numPartitions),
+      numSteps(layout.isDeferred() ? layout.blockSize / PartitionedIR::headSize : 1),
+      deferred(layout.isDeferred()),
+      fft(getFFTOrder(layout.blockSize)),
+      inputBlocks((size_t)layout.blockSize * 2),
+      spectra((size_t)(layout.numPartitions * getSpectrumSize(layout.blockSize))),
+      accumulator((size_t)getSpectrumSize(layout.blockSize)),
+      scratch((size_t)layout.blockSize * 4),
+      output((size_t)layout.blockSize)
+{
+}
+
+PartitionedConvolver::PartitionedConvolver(const PartitionedIR& impulse, int irChannel)
+    : ir(impulse),
+      channel(juce::jmin(irChannel, impulse.getNumChannels() - 1)),
+      reversedHead(impulse.getReversedHead(channel)),
+      history((size_t)PartitionedIR::headSize * 2)
+{
+    for (auto& stage : ir.getStages())
+        stageStates.add(new StageState(stage));
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+    historyPosition = 0;
+    position = 0;
+
+    for (auto* state : stageStates)
+    {
+        std::fill(state->inputBlocks.begin(), state->inputBlocks.end(), 0.0f);
+        std::fill(state->spectra.begin(), state->spectra.end(), 0.0f);
+        std::fill(state->accumulator.begin(), state->accumulator.end(), 0.0f);
+        std::fill(state->scratch.begin(), state->scratch.end(), 0.0f);
+        std::fill(state->output.begin(), state->output.end(), 0.0f);
+        state->newestSpectrum = 0;
+    }
+}
+
+void PartitionedConvolver::process(const float* input, float* output, int numSamples) noexcept
+{
+    // Every stage boundary is a multiple of the head size, so chunks never straddle one.
+    while (numSamples > 0)
+    {
+        auto inBlock = (int)(position % PartitionedIR::headSize);
+        auto chunk = juce::jmin(numSamples, PartitionedIR::headSize - inBlock);
+
+        // The stages need the input before an in-place head overwrites it.
+        for (auto* state : stageStates)
+        {
+            auto offset = (int)(position % state->blockSize);
+            std::copy(input, input + chunk, state->inputBlocks.begin() + state->blockSize + offset);
+        }
+
+        processHead(input, output, chunk);
+
+        for (auto* state : stageStates)
+        {
+            auto offset = (int)(position % state->blockSize);
+            juce::FloatVectorOperations::add(output, state->output.data() + offset, chunk);
+        }
+
+        position += chunk;
+
+        if (position % PartitionedIR::headSize == 0)
+            for (int s = 0; s < stageStates.size(); ++s)
+                advanceStage(s);
+
+        input += chunk;
+        output += chunk;
+        numSamples -= chunk;
+    }
+}
+
+void PartitionedConvolver::processHead(const float* input, float* output, int numSamples) noexcept
+{
+    constexpr int size = PartitionedIR::headSize;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // The history is stored twice over, so the last `size` inputs are always one
+        // contiguous run, oldest first.
+        historyPosition = (historyPosition + 1) % size;
+        history[(size_t)historyPosition] = history[(size_t)(historyPosition + size)] = input[i];
+
+        auto* window = history.data() + historyPosition + 1;
+        auto sum = 0.0f;
+
+        for (int k = 0; k < size; ++k)
+            sum += reversedHead[k] * window[k];
+
+        output[i] = sum;
+    }
+}
+
+void PartitionedConvolver::advanceStage(int stageIndex) noexcept
+{
+    auto& state = *stageStates.getUnchecked(stageIndex);
+
+    // Steps are head-sized chunks, counted from the start of the stage's input block.
+    auto step = (int)((position % state.blockSize) / PartitionedIR::headSize);
+
+    jassert(state.deferred || step == 0);
+
+    // A deferred stage finished the previous block one step ago; it's due now.
+    if (step == 0 && state.deferred)
+        publishOutput(state);
+
+    runStep(stageIndex, step);
+
+    if (! state.deferred)
+        publishOutput(state);
+}
+
+void PartitionedConvolver::runStep(int stageIndex, int step) noexcept
+{
+    auto& state = *stageStates.getUnchecked(stageIndex);
+    auto blockSize = state.blockSize;
+    auto numBins = blockSize + 1;
+    auto spectrumSize = getSpectrumSize(blockSize);
+    auto* scratch = state.scratch.data();
+    auto* real = state.accumulator.data();
+    auto* imaginary = real + numBins;
+
+    if (step == 0)
+    {
+        // Overlap-save: transform the previous and the just-completed block together.
+        std::copy(state.inputBlocks.begin(), state.inputBlocks.end(), scratch);
+        std::fill(scratch + blockSize * 2, scratch + blockSize * 4, 0.0f);
+        state.fft.performRealOnlyForwardTransform(scratch, true);
+
+        state.newestSpectrum = (state.newestSpectrum + 1) % state.numPartitions;
+        deinterleave(scratch, state.spectra.data() + state.newestSpectrum * spectrumSize, numBins);
+        std::copy(state.inputBlocks.begin() + blockSize, state.inputBlocks.end(), state.inputBlocks.begin());
+
+        std::fill(state.accumulator.begin(), state.accumulator.end(), 0.0f);
+    }
+
+    // With more than one step, the steps after the forward FFT share the partitions
+    // out evenly.
+    auto first = 0, last = state.numPartitions;
+
+    if (state.numSteps > 1)
+    {
+        auto numShares = state.numSteps - 1;
+        first = step == 0 ? 0 : state.numPartitions * (step - 1) / numShares;
+        last = step == 0 ? 0 : state.numPartitions * step / numShares;
+    }
+
+    // Partition p of the IR meets the input block p blocks older than the newest.
+    for (int p = first; p < last; ++p)
+    {
+        auto slot = (state.newestSpectrum - p + state.numPartitions) % state.numPartitions;
+        auto* x = state.spectra.data() + slot * spectrumSize;
+        auto* h = ir.getSpectrum(channel, stageIndex, p);
+
+        juce::FloatVectorOperations::addWithMultiply(real, x, h, numBins);
+        juce::FloatVectorOperations::subtractWithMultiply(real, x + numBins, h + numBins, numBins);
+        juce::FloatVectorOperations::addWithMultiply(imaginary, x, h + numBins, numBins);
+        juce::FloatVectorOperations::addWithMultiply(imaginary, x + numBins, h, numBins);
+    }
+
+    if (step == state.numSteps - 1)
+    {
+        std::fill(scratch, scratch + blockSize * 4, 0.0f);
+        interleave(real, scratch, numBins);
+        state.fft.performRealOnlyInverseTransform(scratch);
+    }
+}
+
+void PartitionedConvolver::publishOutput(StageState& state) noexcept
+{
+    // The second half is the linear part; it plays out over the next block.
+    std::copy(state.scratch.begin() + state.blockSize, state.scratch.begin() + state.blockSize * 2, state.output.begin());
+}
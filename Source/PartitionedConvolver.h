@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.h
+    Zero-latency, non-uniformly partitioned convolution for long impulse
+    responses. The first taps run in direct form; the rest are split into FFT
+    partitions that grow 8x per stage, so short blocks stay cheap and a
+    multi-second tail costs a handful of large FFTs. The large stages spread
+    that work evenly over a block period instead of doing it all at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** An impulse response cut into the convolver's layout: the direct-form head and
+    the spectrum of every FFT partition, for each IR channel. Immutable once built,
+    so any number of convolvers can read it. The data is either built here or read
+    back from a cache file written by an earlier build.
+*/
+class PartitionedIR
+{
+public:
+    /// Taps handled in direct form; also the smallest FFT block.
+    static constexpr int headSize = 64;
+    static constexpr int maxBlockSize = 4096;
+    static constexpr int growth = 8;
+
+    /// One uniformly partitioned stage. The smallest starts exactly one block into the
+    /// IR, so its output must be ready the moment its input block completes. Every
+    /// larger one starts two of its blocks in, which leaves it a whole block period to
+    /// compute each output block in.
+    struct Stage
+    {
+        int blockSize, numPartitions, offset;
+
+        bool isDeferred() const noexcept { return offset > blockSize; }
+    };
+
+    /// Partitions an IR on the calling thread. Allocates and runs FFTs, so keep it
+    /// off the audio thread.
+    static std::unique_ptr<PartitionedIR> build(const juce::AudioBuffer<float>& impulse);
+
+    /// Reads a file written by writeToCache() into memory. Returns nullptr if it's
+    /// missing, stale or was written for a different key.
+    static std::unique_ptr<PartitionedIR> loadFromCache(const juce::File& file, juce::int64 key);
+    bool writeToCache(const juce::File& file, juce::int64 key) const;
+
+    int getNumChannels() const noexcept { return numChannels; }
+    int getLength() const noexcept { return length; }
+    const std::vector<Stage>& getStages() const noexcept { return stages; }
+
+    /// headSize taps, stored in reverse so the head is a plain dot product.
+    const float* getReversedHead(int channel) const noexcept;
+
+    /// blockSize + 1 complex bins: all the real parts, then all the imaginary parts.
+    const float* getSpectrum(int channel, int stage, int partition) const noexcept;
+
+private:
+    PartitionedIR(int numChannels, int length);
+
+    int numChannels, length;
+    std::vector<Stage> stages;
+    std::vector<size_t> stageStarts;
+    size_t numFloats = 0;
+
+    std::vector<float> ownedData;
+    const float* data = nullptr;
+
+    float* getWritableData() noexcept { return ownedData.data(); }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedIR)
+};
+
+//==============================================================================
+/** Runs one channel of audio through one channel of a PartitionedIR, with the
+    output sample-aligned to the input for any host block size. The smallest stage
+    computes each output block the moment its input block completes. A deferred
+    stage does one slice of the work every 64 samples instead: the forward FFT,
+    then a share of the partitions' multiply-adds, then the inverse FFT, finishing
+    just as the block is due. A 64-sample callback never pays for a whole block.
+*/
+class PartitionedConvolver
+{
+public:
+    /// Allocates all state; build these off the audio thread.
+    PartitionedConvolver(const PartitionedIR& impulse, int irChannel);
+
+    void reset() noexcept;
+
+    /// Writes the convolution of input into output. The two may be the same buffer.
+    void process(const float* input, float* output, int numSamples) noexcept;
+
+private:
+    struct StageState
+    {
+        StageState(const PartitionedIR::Stage& layout);
+
+        int blockSize, numPartitions, numSteps;
+        bool deferred;
+        juce::dsp::FFT fft;
+
+        // The previous and current input block, the overlap-save FFT input.
+        std::vector<float> inputBlocks;
+
+        // Frequency-domain delay line: the spectra of the last numPartitions input
+        // blocks, newest at newestSpectrum.
+        std::vector<float> spectra;
+        int newestSpectrum = 0;
+
+        // The output block being computed, as split real and imaginary sums.
+        std::vector<float> accumulator;
+
+        std::vector<float> scratch, output;
+    };
+
+    const PartitionedIR& ir;
+    const int channel;
+
+    const float* reversedHead;
+    std::vector<float> history;
+    int historyPosition = 0;
+
+    juce::OwnedArray<StageState> stageStates;
+    juce::int64 position = 0;
+
+    void processHead(const float* input, float* output, int numSamples) noexcept;
+    void advanceStage(int stageIndex) noexcept;
+    void runStep(int stageIndex, int step) noexcept;
+    void publishOutput(StageState& state) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
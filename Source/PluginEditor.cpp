@@ -21,7 +21,9 @@ AudioFXAudioProcessorEditor::AudioFXAudioProcessorEditor (AudioFXAudioProcessor&
     roomSizeSliderAttachment(audioProcessor.apvts, "RoomSize", roomSizeSlider),
     widthSliderAttachment(audioProcessor.apvts, "Width", widthSlider),
     drySliderAttachment(audioProcessor.apvts, "Dry", drySlider),
-    wetSliderAttachment(audioProcessor.apvts, "Wet", wetSlider) 
+    wetSliderAttachment(audioProcessor.apvts, "Wet", wetSlider),
+    spectrum(p),
+    meters(p)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -30,7 +32,7 @@ AudioFXAudioProcessorEditor::AudioFXAudioProcessorEditor (AudioFXAudioProcessor&
         addAndMakeVisible(comp);
     }
 
-    setSize(600, 400);
+    setSize(600, 680);
 }
 
 AudioFXAudioProcessorEditor::~AudioFXAudioProcessorEditor()
@@ -55,6 +57,9 @@ void AudioFXAudioProcessorEditor::resized()
     // subcomponents in your editor..
 
     auto bounds = getLocalBounds();
+    spectrum.setBounds(bounds.removeFromTop(180));
+    meters.setBounds(bounds.removeFromBottom(100));
+
     auto VerticalSliderArea = bounds.removeFromRight(bounds.getWidth() * 0.25);
     auto GainSliderArea = bounds.removeFromLeft(bounds.getWidth() * 0.25);
     auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
@@ -91,6 +96,8 @@ std::vector<juce::Component*> AudioFXAudioProcessorEditor::getComps()
         &roomSizeSlider,
         &widthSlider,
         &drySlider,
-        &wetSlider
+        &wetSlider,
+        &spectrum,
+        &meters
     };
 }
@@ -10,6 +10,8 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "MeterView.h"
+#include "SpectrumView.h"
 
 struct CustomRotarySlider : juce::Slider
 {
@@ -76,6 +78,9 @@ private:
                drySliderAttachment,
                wetSliderAttachment;
 
+    SpectrumView spectrum;
+    MeterView meters;
+
     std::vector<juce::Component*> getComps();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioFXAudioProcessorEditor)
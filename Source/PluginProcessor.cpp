@@ -7,7 +7,14 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+
+// The command-line tools build the processor with AUDIOFX_HEADLESS=1 and no editor.
+#if ! AUDIOFX_HEADLESS
+ #include "PluginEditor.h"
+#endif
+
+static const juce::Identifier impulseResponseProperty("ImpulseResponse");
+static const char* const morphParameterID = "Morph";
 
 //==============================================================================
 AudioFXAudioProcessor::AudioFXAudioProcessor()
@@ -16,16 +23,31 @@ AudioFXAudioProcessor::AudioFXAudioProcessor()
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
         .withInput("Input", juce::AudioChannelSet::stereo(), true)
+        .withInput("Sidechain", juce::AudioChannelSet::stereo(), false)
 #endif
         .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
     )
 #endif
 {
+    for (auto* id : parameterIDs)
+        apvts.addParameterListener(id, this);
+
+    apvts.addParameterListener(morphParameterID, this);
+    morphPosition = apvts.getRawParameterValue(morphParameterID);
+
+    chain.setCoefficients(lowCutCoefficients, peakCoefficients, highCutCoefficients);
+    startTimer(latencyPollMilliseconds);
 }
 
 AudioFXAudioProcessor::~AudioFXAudioProcessor()
 {
+    stopTimer();
+
+    for (auto* id : parameterIDs)
+        apvts.removeParameterListener(id, this);
+
+    apvts.removeParameterListener(morphParameterID, this);
 }
 
 //==============================================================================
@@ -63,7 +85,17 @@ bool AudioFXAudioProcessor::isMidiEffect() const
 
 double AudioFXAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The reverb dominates; everything before it only adds its latency.
+    auto sampleRate = getSampleRate();
+    auto latency = sampleRate > 0.0 ? getLatencySamples() / sampleRate : 0.0;
+
+    if (apvts.getRawParameterValue("ReverbBypass")->load() >= 0.5f)
+        return latency;
+
+    if (apvts.getRawParameterValue("ReverbMode")->load() >= 0.5f)
+        return latency + convolutionReverb.getTailLengthSeconds();
+
+    return latency + StereoReverb::getTailLengthSeconds(apvts.getRawParameterValue("RoomSize")->load(), silenceThresholdDecibels);
 }
 
 int AudioFXAudioProcessor::getNumPrograms()
@@ -98,24 +130,99 @@ void AudioFXAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock
     juce::dsp::ProcessSpec specs;
     specs.sampleRate = sampleRate;
     specs.maximumBlockSize = samplesPerBlock;
-    specs.numChannels = 1;
+    specs.numChannels = (juce::uint32)getMainBusNumInputChannels();
+
+    distortion.prepare(specs);
+    chain.prepare(specs);
+
+    // Hand the FIR the current settings first so prepare() designs the right one.
+    auto settings = getCurrentSettings();
+    setLinearPhaseResponse(settings);
+    linearPhaseCuts.prepare(specs);
+
+    // Reverbs are allocated here rather than in processBlock; the layout can only
+    // change while the processor is stopped.
+    auto numPairs = (getMainBusNumInputChannels() + 1) / 2;
+
+    while (reverbs.size() < numPairs)
+        reverbs.add(new StereoReverb());
+
+    reverbs.removeLast(reverbs.size() - numPairs);
+
+    for (int i = 0; i < numPairs; ++i)
+    {
+        specs.numChannels = (juce::uint32)juce::jmin(2, getMainBusNumInputChannels() - i * 2);
+        reverbs[i]->prepare(specs);
+    }
+
+    specs.numChannels = (juce::uint32)getMainBusNumInputChannels();
+    convolutionReverb.prepare(specs, isNonRealtime());
+
+    auto numWorkers = maxRenderWorkers < 0 ? RenderPool::getDefaultNumWorkers() : maxRenderWorkers;
+
+    if (isNonRealtime() && numWorkers > 0)
+    {
+        if (renderPool == nullptr || renderPool->getNumWorkers() != numWorkers)
+            renderPool = std::make_unique<RenderPool>(numWorkers);
+    }
+    else
+    {
+        renderPool.reset();
+    }
+
+    reverbBypass.prepare(sampleRate, samplesPerBlock);
+    orderFade.prepare(sampleRate, samplesPerBlock);
+    reverbFadeInput.setSize(getMainBusNumInputChannels(), samplesPerBlock);
+    narrowBuffer.setSize(juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()), samplesPerBlock);
+    modulation.prepare(sampleRate, samplesPerBlock);
+    modulationScratch.setSize(ModulationMatrix::numTargets, samplesPerBlock);
+    ducker.prepare(sampleRate, samplesPerBlock);
+
+    // The sample rate may have changed, so every coefficient set is stale. Start
+    // from the current settings rather than gliding in from the old ones.
+    presetBank.prepare(sampleRate);
+    applyPendingPresets();
+    dirtyGroups.store(0);
+    updateDirtyStages(AllGroups);
 
-    leftChain.prepare(specs);
-    rightChain.prepare(specs);
+    for (auto* smoother : { &lowCutFrequency, &highCutFrequency, &peakFrequency, &peakQuality })
+        smoother->reset(sampleRate, filterRampSeconds);
 
-    auto chainsettings = getChainSettings(apvts);
+    peakGainDecibels.reset(sampleRate, filterRampSeconds);
 
-    updateDistortion(chainsettings);
-    updateLowCut(chainsettings);
-    updatePeak(chainsettings);
-    updateHighCut(chainsettings);
-    updateReverb(chainsettings);
+    designFilters(LowCutGroup | PeakGroup | HighCutGroup);
+
+    // Bypassed stages start out bypassed rather than fading out, and a new stage
+    // order applies straight away.
+    distortion.reset();
+    chain.reset();
+    reverbBypass.reset();
+    currentStageOrder = requestedStageOrder;
+    orderFade.setBypassed(false);
+    orderFade.reset();
+    resetIdleState();
+
+    // The host reads the latency straight after this returns.
+    setLatencySamples(stageLatency.load());
 }
 
 void AudioFXAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    renderPool.reset();
+}
+
+void AudioFXAudioProcessor::reset()
+{
+    distortion.reset();
+    chain.reset();
+    linearPhaseCuts.reset();
+    resetReverbs();
+    modulation.reset();
+    ducker.reset();
+    resetIdleState();
+    driveInputPeak = 0.0f;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -125,18 +232,21 @@ bool AudioFXAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) c
     juce::ignoreUnused(layouts);
     return true;
 #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every stage handles any channel count, so mono, stereo, surround, immersive
+    // and Ambisonic layouts are all fine up to maxChannels.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numChannels == 0 || numChannels > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
 #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain only feeds the ducker's level detector, so anything up to stereo.
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > 2)
+        return false;
 #endif
 
     return true;
@@ -147,7 +257,11 @@ bool AudioFXAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) c
 void AudioFXAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
+    AUDIOFX_PROFILE_SCOPE(profiler, processBlock);
+
+    // The sidechain's channels follow the main ones in the buffer, so the main bus
+    // is what the chain runs on.
+    auto totalNumInputChannels = getMainBusNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     // In case we have more outputs than inputs, this code clears any output
@@ -161,38 +275,415 @@ void AudioFXAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce:
 
     //This is where we change the sound
 
-    auto chainsettings = getChainSettings(apvts);
+    if (profiler.isEnabled())
+        profiler.setBlockDeadline(buffer.getNumSamples() / getSampleRate());
 
-    updateDistortion(chainsettings);
-    updateLowCut(chainsettings);
-    updatePeak(chainsettings);
-    updateHighCut(chainsettings);
-    updateReverb(chainsettings);
+    // A recall moving the parameters right now has already posted its snapshot, which
+    // is applied straight after and holds every value they're heading for.
+    if (! recallInProgress.load(std::memory_order_acquire))
+        if (auto groups = dirtyGroups.exchange(0))
+            updateDirtyStages(groups);
 
+    applyPendingPresets();
 
     //This rest of the code processes the audio according to the dsp and its parameters
     juce::dsp::AudioBlock<float> block(buffer);
+    auto inputBlock = block.getSubsetChannelBlock(0, (size_t)totalNumInputChannels);
+
+    // The sidechain is read where the host put it. Disconnected, the ducker isn't
+    // even called.
+    duckGains = nullptr;
+
+    if (auto* sidechainBus = getBus(true, 1); sidechainBus != nullptr && sidechainBus->isEnabled())
+    {
+        AUDIOFX_PROFILE_SCOPE(profiler, ducking);
+        auto sidechain = getBusBuffer(buffer, true, 1);
+        duckGains = ducker.process(juce::dsp::AudioBlock<const float>(sidechain));
+    }
+
+    // Metering and analysis cost nothing until an editor asks for them.
+    auto metering = meteringEnabled.load(std::memory_order_relaxed);
+    auto analysing = analysisEnabled.load(std::memory_order_relaxed);
+    auto startTicks = metering ? juce::Time::getHighResolutionTicks() : 0;
+
+    if (metering)
+    {
+        meterFrame.numChannels = juce::jmin(totalNumInputChannels, TelemetryFrame::maxChannels);
+        measureLevels(inputBlock, meterFrame.inputPeak, meterFrame.inputRms);
+        shapedPeak = -1.0f;
+    }
+
+    if (analysing)
+        inputSamples.push(inputBlock);
+
+    processChain(inputBlock);
+
+    if (analysing)
+        outputSamples.push(inputBlock);
+
+    if (metering)
+        pushTelemetry(inputBlock, startTicks);
+}
+
+void AudioFXAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // The chain's filter sections keep their precision in float, so the block is
+    // narrowed once at the edges rather than every stage being built twice. Slices
+    // never exceed what prepareToPlay() allocated for. Templating the stages on the
+    // sample type is out of scope; the benchmark's ChainDouble case reports what
+    // this conversion costs against the float Chain.
+    auto numChannels = juce::jmin(buffer.getNumChannels(), narrowBuffer.getNumChannels());
+    auto maxSliceSize = narrowBuffer.getNumSamples();
+
+    if (maxSliceSize == 0)
+        return;
+
+    for (int start = 0; start < buffer.getNumSamples(); start += maxSliceSize)
+    {
+        auto numSamples = juce::jmin(maxSliceSize, buffer.getNumSamples() - start);
+        juce::AudioBuffer<float> slice(narrowBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* source = buffer.getReadPointer(ch, start);
+            std::transform(source, source + numSamples, slice.getWritePointer(ch), [](double x) { return (float)x; });
+        }
+
+        processBlock(slice, midiMessages);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* source = slice.getReadPointer(ch);
+            std::copy(source, source + numSamples, buffer.getWritePointer(ch, start));
+        }
+    }
+}
+
+void AudioFXAudioProcessor::pushTelemetry(const juce::dsp::AudioBlock<float>& outputBlock, juce::int64 startTicks) noexcept
+{
+    measureLevels(outputBlock, meterFrame.outputPeak, meterFrame.outputRms);
+
+    // shapedPeak stays negative when the WaveShape stage didn't run. Its input is
+    // measured where it sits in the chain, which needn't be first.
+    auto drivenPeak = driveInputPeak * distortion.getDrive();
+
+    meterFrame.gainReductionDecibels = shapedPeak >= 0.0f && drivenPeak > 0.0f
+                                     ? juce::jmin(0.0f, juce::Decibels::gainToDecibels(shapedPeak / drivenPeak))
+                                     : 0.0f;
+
+    auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    meterFrame.blockMilliseconds = (float)(seconds * 1000.0);
+    meterFrame.cpuLoad = (float)(seconds * getSampleRate() / juce::jmax((size_t)1, outputBlock.getNumSamples()));
+
+    telemetry.push(meterFrame);
+}
+
+const AudioFXAudioProcessor::StageOrderFunction AudioFXAudioProcessor::stageOrders[numStageOrders] =
+{
+    &AudioFXAudioProcessor::processInOrder<driveStage, filterStage, reverbStage>,
+    &AudioFXAudioProcessor::processInOrder<driveStage, reverbStage, filterStage>,
+    &AudioFXAudioProcessor::processInOrder<filterStage, driveStage, reverbStage>,
+    &AudioFXAudioProcessor::processInOrder<filterStage, reverbStage, driveStage>,
+    &AudioFXAudioProcessor::processInOrder<reverbStage, driveStage, filterStage>,
+    &AudioFXAudioProcessor::processInOrder<reverbStage, filterStage, driveStage>
+};
+
+void AudioFXAudioProcessor::processChain(juce::dsp::AudioBlock<float>& inputBlock) noexcept
+{
+    auto numSamples = (int)inputBlock.getNumSamples();
+    auto inputSilent = isSilent(inputBlock);
+    auto* pool = getRenderPool(numSamples);
+
+    if (! inputSilent)
+        resetIdleState();
+
+    // The envelope follows the plugin's input, wherever the stages sit.
+    if (modulation.isActive())
+    {
+        AUDIOFX_PROFILE_SCOPE(profiler, modulation);
+        modulation.process(inputBlock);
+    }
+
+    (this->*stageOrders[currentStageOrder])(inputBlock, pool, inputSilent);
+
+    if (! orderFade.isFading())
+        return;
+
+    auto* gains = orderFade.getNextGains(numSamples);
+
+    for (size_t ch = 0; ch < inputBlock.getNumChannels(); ++ch)
+        juce::FloatVectorOperations::multiply(inputBlock.getChannelPointer(ch), gains, numSamples);
+
+    // Faded all the way out: the new order takes over from silence and fades back in.
+    if (orderFade.isOff())
+    {
+        currentStageOrder = requestedStageOrder;
+        orderFade.setBypassed(false);
+        resetIdleState();
+    }
+}
+
+template <AudioFXAudioProcessor::ChainStage first, AudioFXAudioProcessor::ChainStage second, AudioFXAudioProcessor::ChainStage third>
+void AudioFXAudioProcessor::processInOrder(juce::dsp::AudioBlock<float>& block, RenderPool* pool, bool inputSilent) noexcept
+{
+    static_assert(first != second && second != third && first != third, "every stage runs exactly once");
+
+    auto quiet = runStage<first>(block, pool, inputSilent);
+    quiet = runStage<second>(block, pool, quiet);
+    runStage<third>(block, pool, quiet);
+}
+
+template <AudioFXAudioProcessor::ChainStage stage>
+bool AudioFXAudioProcessor::runStage(juce::dsp::AudioBlock<float>& block, RenderPool* pool, bool inputSilent) noexcept
+{
+    if (stageIdle[stage])
+        return inputSilent;
+
+    if constexpr (stage == driveStage)
+        processDrive(block);
+    else if constexpr (stage == filterStage)
+        processEqualiser(block, pool);
+    else
+        processReverbStage(block, pool);
+
+    // Ringing filters and reverb tails keep the output up after the input stops, so a
+    // stage only goes idle once what it puts out has stayed quiet for longer than
+    // anything can still be in flight. Only a stage whose input is already silent
+    // counts, which is what lets everything after it go idle too.
+    if (inputSilent)
+    {
+        quietSamples[stage] = isSilent(block) ? quietSamples[stage] + (int)block.getNumSamples() : 0;
+
+        if (quietSamples[stage] >= getSettleSamples(stage))
+        {
+            stageIdle[stage] = true;
+            resetChainStage(stage);
+        }
+    }
+
+    return inputSilent && stageIdle[stage];
+}
+
+void AudioFXAudioProcessor::processDrive(juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto metering = meteringEnabled.load(std::memory_order_relaxed) && ! distortion.isBypassed();
+
+    if (metering)
+        driveInputPeak = getPeak(block);
+
+    if (auto* signal = modulation.getSignal(ModulationMatrix::gainTarget))
+    {
+        AUDIOFX_PROFILE_SCOPE(profiler, modulation);
+        auto* gains = modulationScratch.getWritePointer(ModulationMatrix::gainTarget);
+        auto nepersPerUnit = modulationDecibels * std::log(10.0f) / 20.0f;
+
+        for (size_t i = 0; i < block.getNumSamples(); ++i)
+            gains[i] = juce::dsp::FastMathApproximations::exp(signal[i] * nepersPerUnit);
+
+        distortion.setDriveModulation(gains);
+    }
+
+    {
+        AUDIOFX_PROFILE_SCOPE(profiler, waveShape);
+        distortion.process(juce::dsp::ProcessContextReplacing<float>(block));
+    }
+
+    if (metering)
+        shapedPeak = getPeak(block);
+}
+
+void AudioFXAudioProcessor::processEqualiser(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept
+{
+    processFilters(block, pool);
+
+    if (linearPhaseCutsActive)
+    {
+        AUDIOFX_PROFILE_SCOPE(profiler, linearPhaseCuts);
+        linearPhaseCuts.process(juce::dsp::ProcessContextReplacing<float>(block));
+    }
+}
+
+void AudioFXAudioProcessor::processReverbStage(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept
+{
+    if (reverbBypass.isOff())
+        return;
+
+    if (! reverbBypass.isFading())
+    {
+        processReverb(block, pool);
+        return;
+    }
+
+    auto numSamples = block.getNumSamples();
+    auto input = juce::dsp::AudioBlock<float>(reverbFadeInput).getSubsetChannelBlock(0, block.getNumChannels())
+                                                              .getSubBlock(0, numSamples);
+    input.copyFrom(block);
+    processReverb(block, pool);
+
+    auto* gains = reverbBypass.getNextGains((int)numSamples);
+
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        StageBypass::crossfade(block.getChannelPointer(ch), input.getChannelPointer(ch), gains, numSamples);
+
+    if (reverbBypass.isOff())
+        resetReverbs();
+}
+
+int AudioFXAudioProcessor::getSettleSamples(ChainStage stage) const noexcept
+{
+    auto sampleRate = getSampleRate();
+
+    switch (stage)
+    {
+        case driveStage:
+            return distortion.getLatencySamples() * 2 + juce::roundToInt(sampleRate * stageSettleSeconds);
+
+        case filterStage:
+            return (linearPhaseCutsActive ? linearPhaseCuts.getLatencySamples() : 0) * 2
+                 + juce::roundToInt(sampleRate * stageSettleSeconds);
+
+        case reverbStage:
+        case numChainStages:
+            break;
+    }
+
+    // A convolver can sit on a quiet stretch of its IR, so it has to stay quiet for the
+    // whole IR; the Freeverb decays smoothly and only needs a short margin.
+    auto settleSeconds = convolutionReverbActive ? juce::jmax(reverbSettleSeconds, convolutionReverb.getTailLengthSeconds())
+                                                 : reverbSettleSeconds;
+
+    return juce::roundToInt(sampleRate * settleSeconds);
+}
 
-    auto leftblock = block.getSingleChannelBlock(0);
-    auto rightblock = block.getSingleChannelBlock(1);
+void AudioFXAudioProcessor::resetChainStage(ChainStage stage) noexcept
+{
+    switch (stage)
+    {
+        case driveStage:
+            distortion.reset();
+            break;
+
+        case filterStage:
+            chain.reset();
+            linearPhaseCuts.reset();
+            break;
+
+        case reverbStage:
+            resetReverbs();
+            break;
+
+        case numChainStages:
+            break;
+    }
+}
 
-    juce::dsp::ProcessContextReplacing<float> leftcontext(leftblock);
-    juce::dsp::ProcessContextReplacing<float> rightcontext(rightblock);
+void AudioFXAudioProcessor::processReverb(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, reverb);
+    if (convolutionReverbActive)
+    {
+        convolutionReverb.setWetModulation(duckGains);
+        convolutionReverb.process(juce::dsp::ProcessContextReplacing<float>(block), pool);
+        return;
+    }
+
+    auto numChannels = (int)block.getNumChannels();
 
-    leftChain.process(leftcontext);
-    rightChain.process(rightcontext);
+    forEachTask(pool, reverbs.size(), [&](int i)
+    {
+        auto pair = block.getSubsetChannelBlock((size_t)i * 2, (size_t)juce::jmin(2, numChannels - i * 2));
+        reverbs.getUnchecked(i)->setWetModulation(duckGains);
+        reverbs.getUnchecked(i)->process(juce::dsp::ProcessContextReplacing<float>(pair));
+    });
+}
+
+RenderPool* AudioFXAudioProcessor::getRenderPool(int numSamples) const noexcept
+{
+    // Small blocks would spend longer waking the workers than they save. A host that
+    // leaves offline mode without preparing again just gets the serial path.
+    return isNonRealtime() && numSamples >= minParallelBlockSize ? renderPool.get() : nullptr;
+}
+
+void AudioFXAudioProcessor::resetReverbs() noexcept
+{
+    convolutionReverb.reset();
+
+    for (auto* reverb : reverbs)
+        reverb->reset();
+}
+
+float AudioFXAudioProcessor::getPeak(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto range = block.findMinAndMax();
+    return juce::jmax(-range.getStart(), range.getEnd());
+}
+
+void AudioFXAudioProcessor::measureLevels(const juce::dsp::AudioBlock<float>& block, float* peaks, float* rms) noexcept
+{
+    auto numSamples = (int)block.getNumSamples();
+
+    for (size_t ch = 0; ch < juce::jmin(block.getNumChannels(), (size_t)TelemetryFrame::maxChannels); ++ch)
+    {
+        auto* samples = block.getChannelPointer(ch);
+        auto range = juce::FloatVectorOperations::findMinAndMax(samples, numSamples);
+        auto sum = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+            sum += samples[i] * samples[i];
+
+        peaks[ch] = juce::jmax(-range.getStart(), range.getEnd());
+        rms[ch] = numSamples > 0 ? std::sqrt(sum / (float)numSamples) : 0.0f;
+    }
+}
+
+void AudioFXAudioProcessor::setMeteringEnabled(bool shouldMeter) noexcept
+{
+    meteringEnabled = shouldMeter;
+}
+
+void AudioFXAudioProcessor::setAnalysisEnabled(bool shouldAnalyse) noexcept
+{
+    analysisEnabled = shouldAnalyse;
+}
+
+bool AudioFXAudioProcessor::isSilent(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    static const auto threshold = juce::Decibels::decibelsToGain(silenceThresholdDecibels);
+    auto range = block.findMinAndMax();
+
+    return range.getStart() > -threshold && range.getEnd() < threshold;
+}
+
+void AudioFXAudioProcessor::resetIdleState() noexcept
+{
+    std::fill(std::begin(quietSamples), std::end(quietSamples), 0);
+    std::fill(std::begin(stageIdle), std::end(stageIdle), false);
+}
+
+void AudioFXAudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    apvts.state.setProperty(impulseResponseProperty, file.getFullPathName(), nullptr);
+    convolutionReverb.loadImpulseResponse(file);
 }
 
 //==============================================================================
 bool AudioFXAudioProcessor::hasEditor() const
 {
+#if AUDIOFX_HEADLESS
+    return false;
+#else
     return true; // (change this to false if you choose to not supply an editor)
+#endif
 }
 
 juce::AudioProcessorEditor* AudioFXAudioProcessor::createEditor()
 {
+#if AUDIOFX_HEADLESS
+    return nullptr;
+#else
     return new AudioFXAudioProcessorEditor (*this);
     //return new juce::GenericAudioProcessorEditor(*this);
+#endif
 }
 
 //==============================================================================
@@ -201,28 +692,267 @@ void AudioFXAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    PluginState state;
+
+    for (auto* parameter : getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+            state.parameters.emplace_back(ranged->paramID, ranged->convertFrom0to1(ranged->getValue()));
+
+    state.impulseResponsePath = convolutionReverb.getImpulseResponseFile().getFullPathName();
+
+    for (int slot = 0; slot < PresetBank::numSlots; ++slot)
+    {
+        PresetSnapshot snapshot;
+
+        if (! presetBank.getSnapshot(slot, snapshot))
+            continue;
+
+        PluginState::Preset preset;
+        preset.slot = slot;
+
+        for (int i = 0; i < numParameters; ++i)
+            preset.values.emplace_back(parameterIDs[i], snapshot.values[i]);
+
+        state.presets.push_back(std::move(preset));
+    }
+
+    state.morphSlotA = morphSlotA;
+    state.morphSlotB = morphSlotB;
+    state.writeTo(destData);
 }
 
 void AudioFXAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    PluginState state;
+
+    if (state.readFrom(data, sizeInBytes))
+    {
+        restoreState(state);
+        return;
+    }
+
+    // Anything else is a ValueTree from before the binary format, which has no presets.
+    if (PluginState::isBinaryState(data, sizeInBytes))
+        return;
+
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid())
     {
         apvts.replaceState(tree);
 
-        auto chainsettings = getChainSettings(apvts);
+        // The IR path travels in the state tree; only a different file is reloaded.
+        juce::File impulseFile(tree.getProperty(impulseResponseProperty).toString());
 
-        updateDistortion(chainsettings);
-        updateLowCut(chainsettings);
-        updatePeak(chainsettings);
-        updateHighCut(chainsettings);
-        updateReverb(chainsettings);
-        
+        if (impulseFile != convolutionReverb.getImpulseResponseFile())
+            convolutionReverb.loadImpulseResponse(impulseFile);
+
+        presetBank.clearAll();
+        clearMorph();
+
+        // Let the audio thread pick the new values up on its next block rather than
+        // touching the chains from the message thread.
+        dirtyGroups.fetch_or(AllGroups);
+    }
+}
+
+void AudioFXAudioProcessor::restoreState(const PluginState& state)
+{
+    auto findValue = [](const PluginState::Values& values, const juce::String& id, float fallback)
+    {
+        for (auto& value : values)
+            if (value.first == id)
+                return value.second;
+
+        return fallback;
+    };
+
+    // Only parameters that actually change are touched, and no ValueTree is rebuilt.
+    // Ones the blob doesn't know about yet go back to their defaults, as they would
+    // with the ValueTree format.
+    for (auto* parameter : getParameters())
+    {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+        {
+            auto fallback = ranged->convertFrom0to1(ranged->getDefaultValue());
+            auto normalised = ranged->convertTo0to1(findValue(state.parameters, ranged->paramID, fallback));
+
+            if (ranged->getValue() != normalised)
+                ranged->setValueNotifyingHost(normalised);
+        }
+    }
+
+    juce::File impulseFile(state.impulseResponsePath);
+    apvts.state.setProperty(impulseResponseProperty, impulseFile.getFullPathName(), nullptr);
+
+    if (impulseFile != convolutionReverb.getImpulseResponseFile())
+        convolutionReverb.loadImpulseResponse(impulseFile);
+
+    presetBank.clearAll();
+
+    for (auto& preset : state.presets)
+    {
+        float values[numParameters];
+
+        for (int i = 0; i < numParameters; ++i)
+        {
+            auto* parameter = apvts.getParameter(parameterIDs[i]);
+            values[i] = findValue(preset.values, parameterIDs[i], parameter->convertFrom0to1(parameter->getDefaultValue()));
+        }
+
+        presetBank.store(preset.slot, values);
     }
+
+    if (! setMorphPair(state.morphSlotA, state.morphSlotB))
+        clearMorph();
+
+    dirtyGroups.fetch_or(AllGroups);
+}
+
+//==============================================================================
+void AudioFXAudioProcessor::storePreset(int slot)
+{
+    float values[numParameters];
+
+    for (int i = 0; i < numParameters; ++i)
+        values[i] = apvts.getRawParameterValue(parameterIDs[i])->load();
+
+    presetBank.store(slot, values);
+
+    // A morph running from or to this slot follows the new contents.
+    if (slot == morphSlotA || slot == morphSlotB)
+        setMorphPair(morphSlotA, morphSlotB);
+}
+
+bool AudioFXAudioProcessor::recallPreset(int slot)
+{
+    PresetSnapshot snapshot;
+
+    if (! presetBank.getSnapshot(slot, snapshot))
+        return false;
+
+    // The snapshot is posted before any parameter moves, so the audio thread never
+    // sees half a preset without the whole one waiting to be applied.
+    recallInProgress = true;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(pendingLock);
+        pendingRecall = snapshot;
+        recallPending = true;
+        pendingMorph = {};
+        morphPending = true;
+    }
+
+    morphSlotA = morphSlotB = -1;
+    setParameterValues(snapshot.values);
+    recallInProgress = false;
+    return true;
+}
+
+bool AudioFXAudioProcessor::setMorphPair(int slotA, int slotB)
+{
+    PresetSnapshot from, to;
+
+    if (! (presetBank.getSnapshot(slotA, from) && presetBank.getSnapshot(slotB, to)))
+        return false;
+
+    postMorph({ true, from.settings, to.settings });
+    morphSlotA = slotA;
+    morphSlotB = slotB;
+    return true;
+}
+
+void AudioFXAudioProcessor::clearMorph()
+{
+    postMorph({});
+    morphSlotA = morphSlotB = -1;
+}
+
+void AudioFXAudioProcessor::postMorph(const MorphPair& pair)
+{
+    const juce::SpinLock::ScopedLockType sl(pendingLock);
+    pendingMorph = pair;
+    morphPending = true;
+}
+
+void AudioFXAudioProcessor::setParameterValues(const float* values)
+{
+    for (int i = 0; i < numParameters; ++i)
+    {
+        if (auto* parameter = apvts.getParameter(parameterIDs[i]))
+        {
+            auto normalised = parameter->convertTo0to1(values[i]);
+
+            if (parameter->getValue() != normalised)
+                parameter->setValueNotifyingHost(normalised);
+        }
+    }
+}
+
+ChainSettings AudioFXAudioProcessor::getCurrentSettings()
+{
+    if (morph.active)
+        return morphChainSettings(morph.from, morph.to, morphPosition->load());
+
+    return getChainSettings(apvts);
+}
+
+void AudioFXAudioProcessor::applyPendingPresets() noexcept
+{
+    const juce::SpinLock::ScopedTryLockType sl(pendingLock);
+
+    // The message thread is mid-copy; whatever it's posting lands on the next block.
+    if (! sl.isLocked())
+        return;
+
+    if (morphPending)
+    {
+        morph = pendingMorph;
+        morphPending = false;
+        dirtyGroups.fetch_or(AllGroups);
+    }
+
+    if (recallPending)
+    {
+        applySnapshot(pendingRecall);
+        recallPending = false;
+    }
+}
+
+void AudioFXAudioProcessor::applySnapshot(const PresetSnapshot& snapshot) noexcept
+{
+    auto& settings = snapshot.settings;
+
+    updateDistortion(settings);
+    updateOversampling(settings);
+    updateCutMode(settings);
+    updateReverb(settings);
+    updateBypass(settings);
+    updateLinearPhaseResponse(settings);
+    updateStageOrder(settings);
+    updateModulation(settings);
+    updateDucking(settings);
+
+    // A recall jumps rather than glides, straight to coefficients designed when the
+    // preset was stored.
+    chain.setNumCutSections(settings.LowCutSlope + 1, settings.HighCutSlope + 1);
+    lowCutFrequency.setCurrentAndTargetValue(settings.LowCutoff);
+    highCutFrequency.setCurrentAndTargetValue(settings.HighCutoff);
+    peakFrequency.setCurrentAndTargetValue(settings.PeakFreq);
+    peakQuality.setCurrentAndTargetValue(settings.PeakQuality);
+    peakGainDecibels.setCurrentAndTargetValue(settings.PeakGain);
+
+    // Stored at a different rate, and the bank hasn't been prepared for this one yet.
+    if (snapshot.sampleRate != getSampleRate())
+    {
+        designFilters(LowCutGroup | PeakGroup | HighCutGroup);
+        return;
+    }
+
+    lowCutCoefficients = snapshot.lowCut;
+    highCutCoefficients = snapshot.highCut;
+    peakCoefficients = snapshot.peak;
 }
 
 //==============================================================================
@@ -240,83 +970,178 @@ AudioFXAudioProcessor::createParameterLayout()
 
     //This is for Distortion
     layout.add(std::make_unique<juce::AudioParameterFloat>("Gain", "Gain", juce::NormalisableRange<float>(0.0f, 30.f, 0.1f, 1.f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Curve", "Curve", juce::StringArray{ "Tanh", "Soft Clip", "Hard Clip", "Tube", "Foldback" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", juce::StringArray{ "1x", "2x", "4x", "8x" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("OversamplingFilter", "OversamplingFilter", juce::StringArray{ "IIR", "Linear Phase" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterBool>("WaveShapeBypass", "WaveShapeBypass", false));
 
     //This is for Filter
     layout.add(std::make_unique<juce::AudioParameterFloat>("LowCutoff", "LowCutoff", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("LowCutSlope", "LowCutSlope", juce::StringArray{ "12 dB/Oct", "24 dB/Oct", "36 dB/Oct", "48 dB/Oct" }, 0));
     layout.add(std::make_unique<juce::AudioParameterFloat>("HighCutoff", "HighCutoff", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20000.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("HighCutSlope", "HighCutSlope", juce::StringArray{ "12 dB/Oct", "24 dB/Oct", "36 dB/Oct", "48 dB/Oct" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("CutFilter", "CutFilter", juce::StringArray{ "IIR", "Linear Phase" }, 0));
     layout.add(std::make_unique<juce::AudioParameterFloat>("PeakFreq", "PeakFreq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 2000.0f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("PeakQuality", "PeakQuality", juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f), 1.0f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("PeakGain", "PeakGain", juce::NormalisableRange<float>(-20.f, 20.f, 0.5f, 1.f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("LowCutBypass", "LowCutBypass", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("PeakBypass", "PeakBypass", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("HighCutBypass", "HighCutBypass", false));
 
     //This is for Reverb
+    layout.add(std::make_unique<juce::AudioParameterChoice>("ReverbMode", "ReverbMode", juce::StringArray{ "Algorithmic", "Convolution" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("ReverbRate", "ReverbRate", juce::StringArray{ "Full", "Reduced" }, 0));
     layout.add(std::make_unique<juce::AudioParameterFloat>("RoomSize", "RoomSize", juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.0f), 0.3f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("Width", "Width", juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.0f), 0.3f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("Dry", "Dry", juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.0f), 1.f));
     layout.add(std::make_unique<juce::AudioParameterFloat>("Wet", "Wet", juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.0f), 1.f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("ReverbBypass", "ReverbBypass", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("DuckDepth", "DuckDepth", juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.0f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("DuckAttack", "DuckAttack", juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.4f), 5.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("DuckRelease", "DuckRelease", juce::NormalisableRange<float>(10.f, 2000.f, 1.f, 0.4f), 250.f));
+
+    //This is for Modulation
+    layout.add(std::make_unique<juce::AudioParameterFloat>("LfoRate", "LfoRate", juce::NormalisableRange<float>(0.01f, 20.f, 0.01f, 0.3f), 1.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("EnvAttack", "EnvAttack", juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.4f), 5.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("EnvRelease", "EnvRelease", juce::NormalisableRange<float>(5.f, 1000.f, 1.f, 0.4f), 100.f));
+
+    for (auto* source : { "Lfo", "Env" })
+    {
+        for (auto* target : { "LowCut", "Peak", "HighCut", "Gain" })
+        {
+            auto id = juce::String(source) + "To" + target;
+            layout.add(std::make_unique<juce::AudioParameterFloat>(id, id, juce::NormalisableRange<float>(-1.f, 1.f, 0.01f, 1.0f), 0.f));
+        }
+    }
+
+    //This is for the Stage Order
+    layout.add(std::make_unique<juce::AudioParameterChoice>("StageOrder", "StageOrder", juce::StringArray{ "Drive > EQ > Reverb", "Drive > Reverb > EQ", "EQ > Drive > Reverb",
+                                                                                                           "EQ > Reverb > Drive", "Reverb > Drive > EQ", "Reverb > EQ > Drive" }, 0));
+
+    //This is for Presets
+    layout.add(std::make_unique<juce::AudioParameterFloat>(morphParameterID, morphParameterID, juce::NormalisableRange<float>(0.f, 1.f, 0.001f, 1.0f), 0.f));
 
     return layout;
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+uint32_t AudioFXAudioProcessor::getParameterGroup(const juce::String& parameterID)
 {
-    ChainSettings tempsetting;
-    tempsetting.Gain = apvts.getRawParameterValue("Gain")->load();
+    if (parameterID == "Gain" || parameterID == "Curve")
+        return DistortionGroup;
+
+    if (parameterID == "LowCutoff" || parameterID == "LowCutSlope")
+        return LowCutGroup;
+
+    if (parameterID == "HighCutoff" || parameterID == "HighCutSlope")
+        return HighCutGroup;
 
-    tempsetting.LowCutoff = apvts.getRawParameterValue("LowCutoff")->load();
-    tempsetting.PeakFreq = apvts.getRawParameterValue("PeakFreq")->load();
-    tempsetting.HighCutoff = apvts.getRawParameterValue("HighCutoff")->load();
-    tempsetting.PeakGain = apvts.getRawParameterValue("PeakGain")->load();
-    tempsetting.PeakQuality = apvts.getRawParameterValue("PeakQuality")->load();
+    if (parameterID == "CutFilter")
+        return CutModeGroup;
 
-    tempsetting.RoomSize = apvts.getRawParameterValue("RoomSize")->load();
-    tempsetting.Width = apvts.getRawParameterValue("Width")->load();
-    tempsetting.Wet = apvts.getRawParameterValue("Wet")->load();
-    tempsetting.Dry = apvts.getRawParameterValue("Dry")->load();
+    if (parameterID == "PeakFreq" || parameterID == "PeakQuality" || parameterID == "PeakGain")
+        return PeakGroup;
 
+    if (parameterID == "Oversampling" || parameterID == "OversamplingFilter")
+        return OversamplingGroup;
 
-    return tempsetting;
+    if (parameterID.endsWith("Bypass"))
+        return BypassGroup;
+
+    if (parameterID == morphParameterID)
+        return MorphGroup;
+
+    if (parameterID == "StageOrder")
+        return StageOrderGroup;
+
+    if (parameterID.startsWith("Lfo") || parameterID.startsWith("Env"))
+        return ModulationGroup;
+
+    if (parameterID.startsWith("Duck"))
+        return DuckingGroup;
+
+    return ReverbGroup;
 }
 
-void AudioFXAudioProcessor::updateDistortion(const ChainSettings& settings)
+void AudioFXAudioProcessor::parameterChanged(const juce::String& parameterID, float)
 {
-    auto gainindecibals = settings.Gain;
-    auto gain = juce::Decibels::decibelsToGain(gainindecibals);
-    auto lambda = [gain](float in) ->float
-    {
-        return std::tanh(gain * in);
-    };
+    dirtyGroups.fetch_or(getParameterGroup(parameterID));
+}
+
+void AudioFXAudioProcessor::updateDirtyStages(uint32_t groups)
+{
+    // Moving the morph moves everything, continuous values and choices alike.
+    if (morph.active && (groups & MorphGroup))
+        groups |= AllGroups;
+
+    auto chainsettings = getCurrentSettings();
+
+    if (groups & DistortionGroup)
+        updateDistortion(chainsettings);
+    if (groups & LowCutGroup)
+        updateLowCut(chainsettings);
+    if (groups & PeakGroup)
+        updatePeak(chainsettings);
+    if (groups & HighCutGroup)
+        updateHighCut(chainsettings);
+    if (groups & ReverbGroup)
+        updateReverb(chainsettings);
+    if (groups & OversamplingGroup)
+        updateOversampling(chainsettings);
+    if (groups & CutModeGroup)
+        updateCutMode(chainsettings);
+    if (groups & BypassGroup)
+        updateBypass(chainsettings);
+    if (groups & (LowCutGroup | HighCutGroup | BypassGroup))
+        updateLinearPhaseResponse(chainsettings);
+    if (groups & StageOrderGroup)
+        updateStageOrder(chainsettings);
+    if (groups & ModulationGroup)
+        updateModulation(chainsettings);
+    if (groups & DuckingGroup)
+        updateDucking(chainsettings);
+}
 
-    leftChain.get<chainPosition::WaveShape>().functionToUse = lambda;
-    rightChain.get<chainPosition::WaveShape>().functionToUse = lambda;
+void AudioFXAudioProcessor::updateDistortion(const ChainSettings& settings)
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateDistortion);
+    distortion.setDrive(juce::Decibels::decibelsToGain(settings.Gain));
+    distortion.setCurve((WaveshaperCurve)settings.Curve);
 }
 
 void AudioFXAudioProcessor::updateLowCut(const ChainSettings& settings)
 {
-    auto coeffs = juce::dsp::IIR::Coefficients<float>::makeHighPass(getSampleRate(), settings.LowCutoff, 1);
-
-    *leftChain.get<chainPosition::LowCut>().coefficients = *coeffs;
-    *rightChain.get<chainPosition::LowCut>().coefficients = *coeffs;
+    AUDIOFX_PROFILE_SCOPE(profiler, updateLowCut);
+    lowCutFrequency.setTargetValue(settings.LowCutoff);
 
+    // A new slope changes which sections exist, so it can't wait for the glide.
+    if (settings.LowCutSlope + 1 != chain.getNumLowCutSections())
+    {
+        chain.setNumCutSections(settings.LowCutSlope + 1, chain.getNumHighCutSections());
+        designFilters(LowCutGroup);
+    }
 }
 void AudioFXAudioProcessor::updateHighCut(const ChainSettings& settings)
 {
-    auto coeffs = juce::dsp::IIR::Coefficients<float>::makeLowPass(getSampleRate(), settings.HighCutoff, 1);
-
-    *leftChain.get<chainPosition::HighCut>().coefficients = *coeffs;
-    *rightChain.get<chainPosition::HighCut>().coefficients = *coeffs;
+    AUDIOFX_PROFILE_SCOPE(profiler, updateHighCut);
+    highCutFrequency.setTargetValue(settings.HighCutoff);
 
+    if (settings.HighCutSlope + 1 != chain.getNumHighCutSections())
+    {
+        chain.setNumCutSections(chain.getNumLowCutSections(), settings.HighCutSlope + 1);
+        designFilters(HighCutGroup);
+    }
 }
 void AudioFXAudioProcessor::updatePeak(const ChainSettings& settings)
 {
-    auto coeffs = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(), settings.PeakFreq, settings.PeakQuality, juce::Decibels::decibelsToGain(settings.PeakGain));
-
-    *leftChain.get<chainPosition::Peak>().coefficients = *coeffs;
-    *rightChain.get<chainPosition::Peak>().coefficients = *coeffs;
-
+    AUDIOFX_PROFILE_SCOPE(profiler, updatePeak);
+    peakFrequency.setTargetValue(settings.PeakFreq);
+    peakQuality.setTargetValue(settings.PeakQuality);
+    peakGainDecibels.setTargetValue(settings.PeakGain);
 }
 void AudioFXAudioProcessor::updateReverb(const ChainSettings& settings)
 {
-    juce::Reverb::Parameters param;
+    AUDIOFX_PROFILE_SCOPE(profiler, updateReverb);
+    StereoReverb::Parameters param;
     param.damping = settings.RoomSize;
     param.roomSize = settings.RoomSize;
     param.freezeMode = false;
@@ -324,7 +1149,308 @@ void AudioFXAudioProcessor::updateReverb(const ChainSettings& settings)
     param.wetLevel = settings.Wet;
     param.dryLevel = settings.Dry;
 
-    leftChain.get<chainPosition::Reverberation>().setParameters(param);
-    rightChain.get<chainPosition::Reverberation>().setParameters(param);
+    // Reduced only changes anything from 96 kHz up; below that the tank stays at the
+    // session rate. Switching clears the tail.
+    for (auto* reverb : reverbs)
+    {
+        reverb->setParameters(param);
+        reverb->setReducedRate(settings.ReverbRate == 1);
+    }
+
+    convolutionReverb.setMix(settings.Dry, settings.Wet);
+
+    // Whichever mode takes over starts from silence, not from a tail it stopped on.
+    auto convolution = settings.ReverbMode == 1;
+
+    if (convolution != convolutionReverbActive)
+    {
+        convolutionReverbActive = convolution;
+
+        resetReverbs();
+    }
+
+}
+
+void AudioFXAudioProcessor::updateOversampling(const ChainSettings& settings)
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateOversampling);
+    distortion.setOversampling(settings.OversamplingFactor, settings.OversamplingFilter == 1);
+    updateLatency();
+}
+
+void AudioFXAudioProcessor::updateCutMode(const ChainSettings& settings)
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateCutMode);
+    auto linearPhase = settings.CutFilter == 1;
+
+    if (linearPhase == linearPhaseCutsActive)
+        return;
+
+    linearPhaseCutsActive = linearPhase;
+    chain.setStageActive(LockstepChain::lowCutStage, ! linearPhase);
+    chain.setStageActive(LockstepChain::highCutStage, ! linearPhase);
+
+    if (linearPhase)
+    {
+        linearPhaseCuts.reset();
+        updateLinearPhaseResponse(settings);
+    }
+
+    updateLatency();
+}
+
+void AudioFXAudioProcessor::updateLinearPhaseResponse(const ChainSettings& settings)
+{
+    // The FIR is only redesigned while it's in use; switching modes catches it up.
+    if (linearPhaseCutsActive)
+        setLinearPhaseResponse(settings);
+}
+
+void AudioFXAudioProcessor::setLinearPhaseResponse(const ChainSettings& settings) noexcept
+{
+    // In linear-phase mode a bypassed cut is simply left out of the FIR, which the
+    // convolution crossfades to like any other new response.
+    linearPhaseCuts.setResponse(settings.LowCutoff, settings.LowCutBypass ? 0 : settings.LowCutSlope + 1,
+                                settings.HighCutoff, settings.HighCutBypass ? 0 : settings.HighCutSlope + 1);
+}
+
+void AudioFXAudioProcessor::updateBypass(const ChainSettings& settings)
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateBypass);
+    distortion.setBypassed(settings.WaveShapeBypass);
+    chain.setStageBypassed(LockstepChain::lowCutStage, settings.LowCutBypass);
+    chain.setStageBypassed(LockstepChain::peakStage, settings.PeakBypass);
+    chain.setStageBypassed(LockstepChain::highCutStage, settings.HighCutBypass);
+    reverbBypass.setBypassed(settings.ReverbBypass);
+}
+
+void AudioFXAudioProcessor::updateStageOrder(const ChainSettings& settings) noexcept
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateStageOrder);
+    requestedStageOrder = juce::jlimit(0, numStageOrders - 1, settings.StageOrder);
+
+    // Fade out towards a new order; processChain() swaps it in at silence. Asking for
+    // the current one again while that fade is under way just fades back in.
+    orderFade.setBypassed(requestedStageOrder != currentStageOrder);
+}
+
+void AudioFXAudioProcessor::updateDucking(const ChainSettings& settings) noexcept
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateDucking);
+    ducker.setTimes(settings.DuckAttack, settings.DuckRelease);
+    ducker.setDepth(settings.DuckDepth);
+}
 
-}
\ No newline at end of file
+void AudioFXAudioProcessor::updateModulation(const ChainSettings& settings) noexcept
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, updateModulation);
+    using Matrix = ModulationMatrix;
+
+    modulation.setLfoRate(settings.LfoRate);
+    modulation.setEnvelopeTimes(settings.EnvAttack, settings.EnvRelease);
+
+    modulation.setDepth(Matrix::lfoSource, Matrix::lowCutTarget, settings.LfoToLowCut);
+    modulation.setDepth(Matrix::lfoSource, Matrix::peakTarget, settings.LfoToPeak);
+    modulation.setDepth(Matrix::lfoSource, Matrix::highCutTarget, settings.LfoToHighCut);
+    modulation.setDepth(Matrix::lfoSource, Matrix::gainTarget, settings.LfoToGain);
+    modulation.setDepth(Matrix::envelopeSource, Matrix::lowCutTarget, settings.EnvToLowCut);
+    modulation.setDepth(Matrix::envelopeSource, Matrix::peakTarget, settings.EnvToPeak);
+    modulation.setDepth(Matrix::envelopeSource, Matrix::highCutTarget, settings.EnvToHighCut);
+    modulation.setDepth(Matrix::envelopeSource, Matrix::gainTarget, settings.EnvToGain);
+}
+
+void AudioFXAudioProcessor::updateLatency() noexcept
+{
+    // Keep the host's delay compensation in step with the half-band filters and the FIR.
+    stageLatency = distortion.getLatencySamples() + (linearPhaseCutsActive ? linearPhaseCuts.getLatencySamples() : 0);
+}
+
+void AudioFXAudioProcessor::timerCallback()
+{
+    auto latency = stageLatency.load();
+
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+bool AudioFXAudioProcessor::isSmoothingFilters() const noexcept
+{
+    return lowCutFrequency.isSmoothing() || highCutFrequency.isSmoothing()
+        || peakFrequency.isSmoothing() || peakQuality.isSmoothing() || peakGainDecibels.isSmoothing();
+}
+
+void AudioFXAudioProcessor::designFilters(uint32_t groups)
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, designFilters);
+    auto sampleRate = getSampleRate();
+
+    if (groups & LowCutGroup)
+        for (int i = 0, n = chain.getNumLowCutSections(); i < n; ++i)
+            designSVFHighPass(lowCutCoefficients[(size_t)i], sampleRate, lowCutFrequency.getCurrentValue(), getCutSectionQ(n, i));
+    if (groups & PeakGroup)
+        designSVFPeak(peakCoefficients, sampleRate, peakFrequency.getCurrentValue(), peakQuality.getCurrentValue(),
+                      juce::Decibels::decibelsToGain(peakGainDecibels.getCurrentValue()));
+    if (groups & HighCutGroup)
+        for (int i = 0, n = chain.getNumHighCutSections(); i < n; ++i)
+            designSVFLowPass(highCutCoefficients[(size_t)i], sampleRate, highCutFrequency.getCurrentValue(), getCutSectionQ(n, i));
+}
+
+void AudioFXAudioProcessor::processFilters(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept
+{
+    AUDIOFX_PROFILE_SCOPE(profiler, filters);
+
+    if (modulation.isModulated(ModulationMatrix::lowCutTarget) || modulation.isModulated(ModulationMatrix::peakTarget)
+        || modulation.isModulated(ModulationMatrix::highCutTarget))
+    {
+        processModulatedFilters(block, pool);
+        return;
+    }
+
+    // Steady filters: one call over the whole block, no coefficient math.
+    if (! isSmoothingFilters())
+    {
+        chain.process(juce::dsp::ProcessContextReplacing<float>(block), pool);
+        return;
+    }
+
+    auto numSamples = block.getNumSamples();
+    auto interval = (size_t)filterUpdateInterval.load(std::memory_order_relaxed);
+
+    for (size_t start = 0, length = 0; start < numSamples; start += length)
+    {
+        length = juce::jmin(interval, numSamples - start);
+        uint32_t groups = 0;
+
+        // Each sub-block is filtered with the values reached at its end, and only the
+        // filters still gliding are redesigned.
+        if (lowCutFrequency.isSmoothing())
+        {
+            lowCutFrequency.skip((int)length);
+            groups |= LowCutGroup;
+        }
+
+        if (peakFrequency.isSmoothing() || peakQuality.isSmoothing() || peakGainDecibels.isSmoothing())
+        {
+            peakFrequency.skip((int)length);
+            peakQuality.skip((int)length);
+            peakGainDecibels.skip((int)length);
+            groups |= PeakGroup;
+        }
+
+        if (highCutFrequency.isSmoothing())
+        {
+            highCutFrequency.skip((int)length);
+            groups |= HighCutGroup;
+        }
+
+        // Everything settled part way through: the rest of the block goes in one call.
+        if (groups == 0)
+            length = numSamples - start;
+
+        designFilters(groups);
+
+        auto subBlock = block.getSubBlock(start, length);
+        chain.process(juce::dsp::ProcessContextReplacing<float>(subBlock), pool);
+    }
+}
+
+void AudioFXAudioProcessor::processModulatedFilters(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept
+{
+    auto numSamples = block.getNumSamples();
+    const float* tunings[LockstepChain::numStages] = {};
+    uint32_t modulatedGroups = 0, glidingModulatedGroups = 0;
+
+    // A modulated stage glides its base frequency sample by sample as part of its
+    // tuning, and its design follows at the block's end, so the steady path picks up
+    // the right one when the modulation stops.
+    auto tune = [&](LockstepChain::Stage stage, ModulationMatrix::Target target,
+                    MultiplicativeSmoothedValue& frequency, ParameterGroup group)
+    {
+        auto gliding = frequency.isSmoothing();
+        tunings[stage] = getModulatedTuning(target, frequency, (int)numSamples);
+
+        if (tunings[stage] != nullptr)
+        {
+            modulatedGroups |= group;
+
+            if (gliding)
+                glidingModulatedGroups |= group;
+        }
+    };
+
+    tune(LockstepChain::lowCutStage, ModulationMatrix::lowCutTarget, lowCutFrequency, LowCutGroup);
+    tune(LockstepChain::peakStage, ModulationMatrix::peakTarget, peakFrequency, PeakGroup);
+    tune(LockstepChain::highCutStage, ModulationMatrix::highCutTarget, highCutFrequency, HighCutGroup);
+
+    auto interval = (size_t)filterUpdateInterval.load(std::memory_order_relaxed);
+
+    // Everything else still gliding is redesigned every interval, as in processFilters().
+    // The peak's damping and output mix come from its design even while it's modulated.
+    for (size_t start = 0, length = 0; start < numSamples; start += length)
+    {
+        length = juce::jmin(interval, numSamples - start);
+        uint32_t groups = 0;
+
+        auto glide = [&](MultiplicativeSmoothedValue& frequency, ParameterGroup group)
+        {
+            if ((modulatedGroups & group) == 0 && frequency.isSmoothing())
+            {
+                frequency.skip((int)length);
+                groups |= group;
+            }
+        };
+
+        glide(lowCutFrequency, LowCutGroup);
+        glide(peakFrequency, PeakGroup);
+        glide(highCutFrequency, HighCutGroup);
+
+        if (peakQuality.isSmoothing() || peakGainDecibels.isSmoothing())
+        {
+            peakQuality.skip((int)length);
+            peakGainDecibels.skip((int)length);
+            groups |= PeakGroup;
+        }
+
+        // Nothing left gliding: the rest of the block goes in one call.
+        if (groups == 0)
+            length = numSamples - start;
+        else
+            designFilters(groups);
+
+        for (int stage = 0; stage < LockstepChain::numStages; ++stage)
+            if (tunings[stage] != nullptr)
+                chain.setTuning((LockstepChain::Stage)stage, tunings[stage] + start);
+
+        auto subBlock = block.getSubBlock(start, length);
+        chain.process(juce::dsp::ProcessContextReplacing<float>(subBlock), pool);
+    }
+
+    if (glidingModulatedGroups != 0)
+        designFilters(glidingModulatedGroups);
+}
+
+const float* AudioFXAudioProcessor::getModulatedTuning(ModulationMatrix::Target target, MultiplicativeSmoothedValue& frequency,
+                                                        int numSamples) noexcept
+{
+    auto* signal = modulation.getSignal(target);
+
+    if (signal == nullptr)
+        return nullptr;
+
+    // g = tan(pi f / fs), with f moved by up to modulationOctaves. The signal is
+    // clamped to -1..1, so the exponent stays where the fast exp holds, and f stays
+    // below 0.49 fs, where the fast tan does.
+    auto* g = modulationScratch.getWritePointer(target);
+    auto sampleRate = (float)getSampleRate();
+    auto nepersPerUnit = modulationOctaves * std::log(2.0f);
+    auto radiansPerHertz = juce::MathConstants<float>::pi / sampleRate;
+    auto maxFrequency = sampleRate * 0.49f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto modulated = frequency.getNextValue() * juce::dsp::FastMathApproximations::exp(signal[i] * nepersPerUnit);
+        g[i] = juce::dsp::FastMathApproximations::tan(juce::jlimit(1.0f, maxFrequency, modulated) * radiansPerHertz);
+    }
+
+    return g;
+}
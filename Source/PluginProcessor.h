@@ -9,20 +9,29 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "FilterDesign.h"
+#include "LockstepChain.h"
+#include "DistortionStage.h"
+#include "StereoReverb.h"
+#include "LinearPhaseCuts.h"
+#include "ConvolutionReverb.h"
+#include "StageBypass.h"
+#include "Telemetry.h"
+#include "Profiler.h"
+#include "RenderPool.h"
+#include "PresetBank.h"
+#include "PluginState.h"
+#include "ModulationMatrix.h"
+#include "SidechainDucker.h"
 
 //==============================================================================
 /**
 */
 
-struct ChainSettings
-{
-    float Gain, HighCutoff, LowCutoff, PeakFreq, PeakQuality, PeakGain, RoomSize, Width, Dry, Wet;
-};
-
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
-
-
-class AudioFXAudioProcessor : public juce::AudioProcessor
+class AudioFXAudioProcessor : public juce::AudioProcessor,
+                              private juce::AudioProcessorValueTreeState::Listener,
+                              private juce::Timer
                                #if JucePlugin_Enable_ARA
                                 , public juce::AudioProcessorARAExtension
                                #endif
@@ -36,12 +45,20 @@ public:
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    /// Clears every tail, delay line and envelope without reallocating. Hosts call it
+    /// on transport jumps; it is safe on the audio thread.
+    void reset() override;
+
 #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
 
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    /// 64-bit hosts hand their blocks straight in; the chain itself runs in float.
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -67,29 +84,277 @@ public:
 
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     /// createParameterLayout() is the fucntion that returns parameterlayout object for this Project
+
+    /// Filter coefficients are recomputed every this many samples while LowCutoff,
+    /// PeakFreq, PeakQuality, PeakGain or HighCutoff is gliding towards a new value.
+    /// Smaller is smoother and costs more; steady filters are never recomputed.
+    void setFilterUpdateInterval(int numSamples) noexcept { filterUpdateInterval = juce::jlimit(1, 512, numSamples); }
+    int getFilterUpdateInterval() const noexcept { return filterUpdateInterval; }
+
+    static constexpr int defaultFilterUpdateInterval = 32;
+
+    /// The most worker threads an offline render may spread channels over, from the
+    /// next prepareToPlay(). The default, -1, is one per spare core; a host that
+    /// already runs an instance per core should pass 0 so each one renders serially.
+    void setMaxRenderWorkers(int numWorkers) noexcept { maxRenderWorkers = numWorkers; }
+
+    /// Sets the impulse response for the Convolution reverb mode. It loads in the
+    /// background and is saved with the plugin state.
+    void loadImpulseResponse(const juce::File& file);
+
+    /// Captures the current parameters into a bank slot, designing its filters there and
+    /// then. Message thread only.
+    void storePreset(int slot);
+
+    /// Swaps a stored snapshot in on the next block, without any coefficient design on
+    /// the audio thread, and moves the parameters to match so the host and editor
+    /// follow. Ends any morph. Message thread only.
+    bool recallPreset(int slot);
+
+    /// While a pair is set, the Morph parameter sweeps every setting from slot A (0)
+    /// to slot B (1) and the other parameters are ignored; clearMorph() hands control
+    /// back to them. Message thread only.
+    bool setMorphPair(int slotA, int slotB);
+    void clearMorph();
+
+    PresetBank& getPresetBank() noexcept { return presetBank; }
+
+    /// Any layout works as long as input and output match and it fits in this many channels.
+    static constexpr int maxChannels = 16;
+
+    static_assert(maxChannels <= TelemetryFrame::maxChannels, "every channel needs a meter");
+
+    /// Levels, waveshaper gain reduction and CPU time, one frame per block, for the
+    /// editor to pop() on the message thread. Only filled while metering is enabled.
+    TelemetryQueue& getTelemetry() noexcept { return telemetry; }
+    void setMeteringEnabled(bool shouldMeter) noexcept;
+
+    /// Mono mixes of what goes into and comes out of the chain, for the spectrum
+    /// analyzer. Only filled while analysis is enabled.
+    SampleFifo& getInputSamples() noexcept { return inputSamples; }
+    SampleFifo& getOutputSamples() noexcept { return outputSamples; }
+    void setAnalysisEnabled(bool shouldAnalyse) noexcept;
+
+    /// Stage and coefficient-update timings. Only records in builds configured with
+    /// AUDIOFX_PROFILING, and only once enabled.
+    Profiler& getProfiler() noexcept { return profiler; }
+
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
     //apvts is the object for valuetreestate
 private:
 
-    using Filter = juce::dsp::IIR::Filter<float>;
-    using Reverb = juce::dsp::Reverb;
-    using Waveshaper = juce::dsp::WaveShaper<float, std::function<float(float)>>;
+    // WaveShape runs (optionally oversampled) on the channel data, then LowCut, Peak
+    // and HighCut run for all channels in SIMD lanes, and one stereo reverb per channel
+    // pair finishes the chain (a mono one for an odd last channel). In linear-phase
+    // mode the two cuts move out of the chain into one FIR convolution, and in
+    // Convolution reverb mode one convolver per channel replaces the Freeverbs.
+    DistortionStage distortion;
+    LockstepChain chain;
+    LinearPhaseCuts linearPhaseCuts;
+    bool linearPhaseCutsActive = false;
+
+    // The latency the stages add, as of the last update on the audio thread. The host
+    // hears about it from the message thread: setLatencySamples() calls its listeners
+    // under a lock.
+    std::atomic<int> stageLatency{ 0 };
+    static constexpr int latencyPollMilliseconds = 50;
+
+    juce::OwnedArray<StereoReverb> reverbs;
+    ConvolutionReverb convolutionReverb;
+    bool convolutionReverbActive = false;
+
+    // WaveShape and the three filters handle their own bypass; the reverb's fade is
+    // done here, across whichever reverb mode is running.
+    StageBypass reverbBypass;
+    juce::AudioBuffer<float> reverbFadeInput;
+
+    // Where a 64-bit host's block is narrowed to before it runs through the chain.
+    juce::AudioBuffer<float> narrowBuffer;
+
+    // Each parameter group owns one bit. parameterChanged() sets the bit from whatever
+    // thread the host automates on, and processBlock() only rebuilds the stages whose
+    // bit it swapped out, so a steady session does no coefficient math at all.
+    enum ParameterGroup : uint32_t
+    {
+        DistortionGroup   = 1 << 0,
+        LowCutGroup       = 1 << 1,
+        PeakGroup         = 1 << 2,
+        HighCutGroup      = 1 << 3,
+        ReverbGroup       = 1 << 4,
+        OversamplingGroup = 1 << 5,
+        CutModeGroup      = 1 << 6,
+        BypassGroup       = 1 << 7,
+        MorphGroup        = 1 << 8,
+        StageOrderGroup   = 1 << 9,
+        ModulationGroup   = 1 << 10,
+        DuckingGroup      = 1 << 11,
+        AllGroups         = DistortionGroup | LowCutGroup | PeakGroup | HighCutGroup | ReverbGroup | OversamplingGroup | CutModeGroup | BypassGroup | MorphGroup
+                          | StageOrderGroup | ModulationGroup | DuckingGroup
+    };
+
+    std::atomic<uint32_t> dirtyGroups{ AllGroups };
 
-    using MonoChain = juce::dsp::ProcessorChain < Waveshaper, Filter, Filter, Filter, Reverb >;
+    // Filter coefficients are written in place, so each stage keeps one set that
+    // every lane group points at.
+    LockstepChain::CutCoefficients lowCutCoefficients, highCutCoefficients;
+    SVFCoefficients peakCoefficients;
 
-    MonoChain leftChain, rightChain;
+    // The update functions only move these targets; processFilters() glides towards
+    // them and redesigns the coefficients once per filterUpdateInterval samples.
+    using MultiplicativeSmoothedValue = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
 
-    enum chainPosition
+    MultiplicativeSmoothedValue lowCutFrequency, highCutFrequency, peakFrequency, peakQuality;
+    juce::SmoothedValue<float> peakGainDecibels;
+    std::atomic<int> filterUpdateInterval{ defaultFilterUpdateInterval };
+
+    static constexpr double filterRampSeconds = 0.05;
+
+    // Modulation. A full-depth signal moves a filter this many octaves either way, or
+    // the drive this many dB. Modulated filters are retuned every sample from the
+    // matrix's signals; modulationScratch holds one tuning or gain curve per target.
+    static constexpr float modulationOctaves = 4.0f;
+    static constexpr float modulationDecibels = 24.0f;
+
+    ModulationMatrix modulation;
+    juce::AudioBuffer<float> modulationScratch;
+
+    // Reverb ducking. duckGains is the wet gain curve for the current block, or
+    // nullptr when the sidechain is disconnected or quiet.
+    SidechainDucker ducker;
+    const float* duckGains = nullptr;
+
+    // The three stages the StageOrder parameter rearranges. Each order is its own
+    // processInOrder() instantiation, so switching costs one indirect call per block
+    // and the stages inside are called directly.
+    enum ChainStage
     {
-        WaveShape, LowCut, Peak, HighCut, Reverberation
+        driveStage,
+        filterStage,
+        reverbStage,
+        numChainStages
     };
 
+    static constexpr int numStageOrders = 6;
+
+    using StageOrderFunction = void (AudioFXAudioProcessor::*)(juce::dsp::AudioBlock<float>&, RenderPool*, bool) noexcept;
+    static const StageOrderFunction stageOrders[numStageOrders];
+
+    // A new order only takes over once orderFade has taken the output down to
+    // silence, so no stage is ever switched with signal running through it.
+    int currentStageOrder = 0, requestedStageOrder = 0;
+    StageBypass orderFade;
+
+    // Silence handling. Once a stage's input is silent and what it puts out has
+    // stayed below the threshold for a while, it is reset and skipped; each stage
+    // waits on its own tail, and one only counts once everything before it is idle.
+    // Any input at all wakes them all.
+    static constexpr float silenceThresholdDecibels = -90.0f;
+    static constexpr double stageSettleSeconds = 0.05;
+    static constexpr double reverbSettleSeconds = 0.1;
+
+    int quietSamples[numChainStages] = {};
+    bool stageIdle[numChainStages] = {};
+
+    static bool isSilent(const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    // Metering. meterFrame and the WaveShape peaks are audio-thread scratch for the
+    // frame being built; telemetry is the only thing the editor touches.
+    TelemetryQueue telemetry;
+    std::atomic<bool> meteringEnabled{ false };
+    TelemetryFrame meterFrame;
+    float driveInputPeak = 0.0f, shapedPeak = -1.0f;
+
+    SampleFifo inputSamples, outputSamples;
+    std::atomic<bool> analysisEnabled{ false };
+
+    Profiler profiler;
+
+    // Offline renders only: prepareToPlay() starts the pool when the host is
+    // bouncing, and blocks at least this long spread each stage's independent
+    // channels over it. Anything else runs serially on the audio thread.
+    std::unique_ptr<RenderPool> renderPool;
+    int maxRenderWorkers = -1;
+    static constexpr int minParallelBlockSize = 512;
+
+    RenderPool* getRenderPool(int numSamples) const noexcept;
+
+    // Presets. The bank belongs to the message thread; snapshots and morph pairs cross
+    // to the audio thread through pendingLock, which processBlock() only ever tries,
+    // so one posted mid-block simply lands on the next.
+    struct MorphPair
+    {
+        bool active = false;
+        ChainSettings from {}, to {};
+    };
+
+    PresetBank presetBank;
+    juce::SpinLock pendingLock;
+    PresetSnapshot pendingRecall;
+    MorphPair pendingMorph;
+    bool recallPending = false, morphPending = false;
+
+    // Set while recallPreset() moves the parameters, so a half-moved group isn't taken
+    // for an ordinary change; the snapshot already holds where they're going.
+    std::atomic<bool> recallInProgress{ false };
+
+    MorphPair morph;
+    std::atomic<float>* morphPosition = nullptr;
+    int morphSlotA = -1, morphSlotB = -1;
+
+    ChainSettings getCurrentSettings();
+    void postMorph(const MorphPair& pair);
+    void applyPendingPresets() noexcept;
+    void applySnapshot(const PresetSnapshot& snapshot) noexcept;
+    void restoreState(const PluginState& state);
+    void setParameterValues(const float* values);
+
+    static float getPeak(const juce::dsp::AudioBlock<float>& block) noexcept;
+    static void measureLevels(const juce::dsp::AudioBlock<float>& block, float* peaks, float* rms) noexcept;
+    void pushTelemetry(const juce::dsp::AudioBlock<float>& outputBlock, juce::int64 startTicks) noexcept;
+    void resetIdleState() noexcept;
+
+    static uint32_t getParameterGroup(const juce::String& parameterID);
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void updateDirtyStages(uint32_t groups);
+
+    bool isSmoothingFilters() const noexcept;
+    void designFilters(uint32_t groups);
+    void processChain(juce::dsp::AudioBlock<float>& block) noexcept;
+
+    template <ChainStage first, ChainStage second, ChainStage third>
+    void processInOrder(juce::dsp::AudioBlock<float>& block, RenderPool* pool, bool inputSilent) noexcept;
+
+    /// Runs one stage unless it's idle. Returns whether its output is known silent.
+    template <ChainStage stage>
+    bool runStage(juce::dsp::AudioBlock<float>& block, RenderPool* pool, bool inputSilent) noexcept;
+
+    void processDrive(juce::dsp::AudioBlock<float>& block) noexcept;
+    void processEqualiser(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept;
+    void processReverbStage(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept;
+    int getSettleSamples(ChainStage stage) const noexcept;
+    void resetChainStage(ChainStage stage) noexcept;
+    void processFilters(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept;
+    void processModulatedFilters(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept;
+    const float* getModulatedTuning(ModulationMatrix::Target target, MultiplicativeSmoothedValue& frequency, int numSamples) noexcept;
+    void processReverb(juce::dsp::AudioBlock<float>& block, RenderPool* pool) noexcept;
+    void resetReverbs() noexcept;
+
     //Function Declarations
     void updateDistortion(const ChainSettings& settings);
     void updateLowCut(const ChainSettings& settings);
     void updatePeak(const ChainSettings& settings);
     void updateHighCut(const ChainSettings& settings);
     void updateReverb(const ChainSettings& settings);
+    void updateOversampling(const ChainSettings& settings);
+    void updateCutMode(const ChainSettings& settings);
+    void updateLinearPhaseResponse(const ChainSettings& settings);
+    void setLinearPhaseResponse(const ChainSettings& settings) noexcept;
+    void updateBypass(const ChainSettings& settings);
+    void updateStageOrder(const ChainSettings& settings) noexcept;
+    void updateModulation(const ChainSettings& settings) noexcept;
+    void updateDucking(const ChainSettings& settings) noexcept;
+    void updateLatency() noexcept;
+    void timerCallback() override;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioFXAudioProcessor)
 };
@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    PluginState.cpp
+    The compact binary form of the plugin's saved state. Parameters are stored
+    by ID, so blobs survive parameters being added or reordered; anything that
+    doesn't start with the magic is left to the old ValueTree loader.
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+
+namespace
+{
+    const char stateMagic[4] = { 'A', 'F', 'X', 'S' };
+
+    // Far more than any version will have; a larger count means a corrupt blob.
+    constexpr int maxCount = 4096;
+
+    void writeValues(juce::OutputStream& stream, const PluginState::Values& values)
+    {
+        stream.writeCompressedInt((int)values.size());
+
+        for (auto& value : values)
+        {
+            stream.writeString(value.first);
+            stream.writeFloat(value.second);
+        }
+    }
+
+    bool readValues(juce::InputStream& stream, PluginState::Values& values)
+    {
+        auto count = stream.readCompressedInt();
+
+        if (! juce::isPositiveAndNotGreaterThan(count, maxCount))
+            return false;
+
+        values.clear();
+        values.reserve((size_t)count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            // Reads past the end return zeros, so a truncated blob has to be caught
+            // before each entry rather than afterwards.
+            if (stream.isExhausted())
+                return false;
+
+            auto id = stream.readString();
+            auto value = stream.readFloat();
+            values.emplace_back(id, value);
+        }
+
+        return true;
+    }
+}
+
+void PluginState::writeTo(juce::MemoryBlock& destination) const
+{
+    juce::MemoryOutputStream stream(destination, true);
+
+    stream.write(stateMagic, sizeof(stateMagic));
+    stream.writeInt(currentVersion);
+
+    writeValues(stream, parameters);
+    stream.writeString(impulseResponsePath);
+
+    stream.writeCompressedInt((int)presets.size());
+
+    for (auto& preset : presets)
+    {
+        stream.writeCompressedInt(preset.slot);
+        writeValues(stream, preset.values);
+    }
+
+    stream.writeCompressedInt(morphSlotA);
+    stream.writeCompressedInt(morphSlotB);
+}
+
+bool PluginState::readFrom(const void* data, int sizeInBytes)
+{
+    if (! isBinaryState(data, sizeInBytes))
+        return false;
+
+    juce::MemoryInputStream stream(data, (size_t)sizeInBytes, false);
+    stream.skipNextBytes(sizeof(stateMagic));
+
+    // Later versions only ever append, but a blob from one can't be trusted to
+    // mean the same thing here.
+    auto version = stream.readInt();
+
+    if (version < 1 || version > currentVersion)
+        return false;
+
+    if (! readValues(stream, parameters))
+        return false;
+
+    if (stream.isExhausted())
+        return false;
+
+    impulseResponsePath = stream.readString();
+
+    auto numPresets = stream.readCompressedInt();
+
+    if (! juce::isPositiveAndNotGreaterThan(numPresets, maxCount))
+        return false;
+
+    presets.resize((size_t)numPresets);
+
+    for (auto& preset : presets)
+    {
+        preset.slot = stream.readCompressedInt();
+
+        if (! readValues(stream, preset.values))
+            return false;
+    }
+
+    if (stream.isExhausted())
+        return false;
+
+    morphSlotA = stream.readCompressedInt();
+    morphSlotB = stream.readCompressedInt();
+    return true;
+}
+
+bool PluginState::isBinaryState(const void* data, int sizeInBytes) noexcept
+{
+    return data != nullptr && sizeInBytes >= (int)sizeof(stateMagic) + 4
+        && std::memcmp(data, stateMagic, sizeof(stateMagic)) == 0;
+}
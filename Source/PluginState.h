@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    PluginState.h
+    The compact binary form of the plugin's saved state. Parameters are stored
+    by ID, so blobs survive parameters being added or reordered; anything that
+    doesn't start with the magic is left to the old ValueTree loader.
+
+    Layout, little-endian:
+      char[4]   "AFXS"
+      int32     version
+      cint      number of parameters, then that many (string ID, float value)
+      string    impulse response path, empty for none
+      cint      number of stored presets, then per preset:
+                  cint slot, cint count, then count (string ID, float value)
+      cint      morph slot A, cint morph slot B (-1 for none)
+
+    cint is MemoryOutputStream::writeCompressedInt(); values are plain, not
+    normalised.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct PluginState
+{
+    static constexpr int currentVersion = 1;
+
+    using Values = std::vector<std::pair<juce::String, float>>;
+
+    struct Preset
+    {
+        int slot = 0;
+        Values values;
+    };
+
+    Values parameters;
+    juce::String impulseResponsePath;
+    std::vector<Preset> presets;
+    int morphSlotA = -1, morphSlotB = -1;
+
+    void writeTo(juce::MemoryBlock& destination) const;
+
+    /// False if data isn't in this format, is from a newer version, or is truncated.
+    bool readFrom(const void* data, int sizeInBytes);
+
+    static bool isBinaryState(const void* data, int sizeInBytes) noexcept;
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Stored presets, each kept as a ready-to-apply snapshot: the parameter
+    values, the settings they make, and the filter coefficients designed for
+    the current sample rate. All of it is built on the message thread, so
+    recalling a preset only copies numbers on the audio thread.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+void PresetBank::prepare(double newSampleRate)
+{
+    const juce::ScopedLock sl(lock);
+    sampleRate = newSampleRate;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+        if (stored[slot])
+            design(snapshots[slot]);
+}
+
+void PresetBank::store(int slot, const float* values)
+{
+    if (! juce::isPositiveAndBelow(slot, numSlots))
+        return;
+
+    const juce::ScopedLock sl(lock);
+    auto& snapshot = snapshots[slot];
+
+    std::copy(values, values + numParameters, snapshot.values);
+    design(snapshot);
+    stored[slot] = true;
+}
+
+void PresetBank::clear(int slot)
+{
+    const juce::ScopedLock sl(lock);
+
+    if (juce::isPositiveAndBelow(slot, numSlots))
+        stored[slot] = false;
+}
+
+void PresetBank::clearAll()
+{
+    const juce::ScopedLock sl(lock);
+    std::fill(std::begin(stored), std::end(stored), false);
+}
+
+bool PresetBank::isStored(int slot) const
+{
+    const juce::ScopedLock sl(lock);
+    return juce::isPositiveAndBelow(slot, numSlots) && stored[slot];
+}
+
+bool PresetBank::getSnapshot(int slot, PresetSnapshot& destination) const
+{
+    const juce::ScopedLock sl(lock);
+
+    if (! (juce::isPositiveAndBelow(slot, numSlots) && stored[slot]))
+        return false;
+
+    destination = snapshots[slot];
+    return true;
+}
+
+void PresetBank::design(PresetSnapshot& snapshot) const
+{
+    auto& settings = snapshot.settings = getChainSettings(snapshot.values);
+    snapshot.sampleRate = sampleRate;
+
+    // Every section is designed, so a slope the snapshot doesn't use still holds
+    // sensible numbers.
+    auto numLowCut = settings.LowCutSlope + 1;
+    auto numHighCut = settings.HighCutSlope + 1;
+
+    for (int i = 0; i < LockstepChain::maxCutSections; ++i)
+    {
+        designSVFHighPass(snapshot.lowCut[(size_t)i], sampleRate, settings.LowCutoff, getCutSectionQ(numLowCut, juce::jmin(i, numLowCut - 1)));
+        designSVFLowPass(snapshot.highCut[(size_t)i], sampleRate, settings.HighCutoff, getCutSectionQ(numHighCut, juce::jmin(i, numHighCut - 1)));
+    }
+
+    designSVFPeak(snapshot.peak, sampleRate, settings.PeakFreq, settings.PeakQuality, juce::Decibels::decibelsToGain(settings.PeakGain));
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Stored presets, each kept as a ready-to-apply snapshot: the parameter
+    values, the settings they make, and the filter coefficients designed for
+    the current sample rate. All of it is built on the message thread, so
+    recalling a preset only copies numbers on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChainSettings.h"
+#include "FilterDesign.h"
+#include "LockstepChain.h"
+
+struct PresetSnapshot
+{
+    /// Plain values in parameterIDs order.
+    float values[numParameters] = {};
+    ChainSettings settings {};
+
+    /// Designed for this rate; a snapshot taken at another rate is redesigned on
+    /// the audio thread instead.
+    double sampleRate = 0.0;
+    LockstepChain::CutCoefficients lowCut {}, highCut {};
+    SVFCoefficients peak {};
+};
+
+class PresetBank
+{
+public:
+    static constexpr int numSlots = 8;
+
+    PresetBank() = default;
+
+    /// Redesigns every stored snapshot for a new rate.
+    void prepare(double sampleRate);
+
+    /// Stores numParameters plain values in parameterIDs order.
+    void store(int slot, const float* values);
+    void clear(int slot);
+    void clearAll();
+
+    bool isStored(int slot) const;
+
+    /// Copies a stored snapshot out. Returns false for an empty or invalid slot.
+    bool getSnapshot(int slot, PresetSnapshot& destination) const;
+
+private:
+    juce::CriticalSection lock;
+    PresetSnapshot snapshots[numSlots];
+    bool stored[numSlots] = {};
+    double sampleRate = 44100.0;
+
+    void design(PresetSnapshot& snapshot) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetBank)
+};
@@ -0,0 +1,334 @@
+/*
+  ==============================================================================
+
+    Profiler.cpp
+    Opt-in hot-path instrumentation. Scoped cycle-counter timers around each
+    stage and each coefficient update feed preallocated per-thread histograms
+    and a trace ring, which can be dumped as Chrome trace_event JSON and as a
+    summary table.
+
+  ==============================================================================
+*/
+
+#include "Profiler.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    std::atomic<int> nextThreadId{ 0 };
+    thread_local const int profilerThreadId = nextThreadId++;
+
+    constexpr int subBucketCount = 1 << Profiler::subBucketBits;
+}
+
+Profiler::~Profiler()
+{
+    enabled = false;
+}
+
+juce::uint64 Profiler::readCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64)__rdtsc();
+   #elif defined (__aarch64__) && ! JUCE_MSVC
+    juce::uint64 ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+   #else
+    return (juce::uint64)juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+void Profiler::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled && slots == nullptr)
+    {
+        slots.reset(new ThreadSlot[maxThreads]());
+
+        for (int i = 0; i < maxThreads; ++i)
+            slots[i].trace.resize((size_t)traceCapacity);
+
+        clear();
+    }
+
+    if (shouldBeEnabled && ! enabled)
+    {
+        // The cycle counter's rate isn't known up front; time it against the clock.
+        auto startCycles = readCycleCounter();
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        juce::Thread::sleep(20);
+        auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        cyclesPerSecond = juce::jmax(1.0, (double)(readCycleCounter() - startCycles) / elapsed);
+
+        if (originCycles == 0)
+            originCycles = startCycles;
+    }
+
+    enabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+void Profiler::clear()
+{
+    jassert(! enabled);
+
+    if (slots == nullptr)
+        return;
+
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        auto& slot = slots[i];
+        slot.owner = -1;
+        slot.traceWritten = 0;
+
+        for (auto& histogram : slot.zones)
+            histogram.clear();
+
+        slot.load.clear();
+    }
+
+    originCycles = 0;
+}
+
+void Profiler::setBlockDeadline(double seconds) noexcept
+{
+    deadlineSeconds.store(seconds, std::memory_order_relaxed);
+}
+
+Profiler::ThreadSlot* Profiler::getSlotForThisThread() noexcept
+{
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        auto owner = slots[i].owner.load(std::memory_order_relaxed);
+
+        if (owner == profilerThreadId)
+            return &slots[i];
+
+        if (owner == -1 && slots[i].owner.compare_exchange_strong(owner, profilerThreadId))
+            return &slots[i];
+    }
+
+    return nullptr;
+}
+
+void Profiler::record(ProfileZone zone, juce::uint64 startCycles, juce::uint64 endCycles) noexcept
+{
+    auto* slot = getSlotForThisThread();
+
+    if (slot == nullptr)
+        return;
+
+    auto duration = endCycles - startCycles;
+    slot->zones[(int)zone].add(duration);
+
+    if (zone == ProfileZone::processBlock)
+    {
+        auto deadlineCycles = deadlineSeconds.load(std::memory_order_relaxed) * cyclesPerSecond;
+
+        if (deadlineCycles > 0.0)
+            slot->load.add((juce::uint64)((double)duration * 1000.0 / deadlineCycles));
+    }
+
+    auto written = slot->traceWritten.load(std::memory_order_relaxed);
+    slot->trace[(size_t)(written % traceCapacity)] = { startCycles, duration, zone };
+    slot->traceWritten.store(written + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const juce::File& file) const
+{
+    file.deleteFile();
+    juce::FileOutputStream stream(file);
+
+    if (! stream.openedOk())
+        return false;
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    auto first = true;
+
+    auto writeEvent = [&](const juce::String& event)
+    {
+        stream << (first ? "" : ",\n") << event;
+        first = false;
+    };
+
+    for (int i = 0; slots != nullptr && i < maxThreads; ++i)
+    {
+        auto& slot = slots[i];
+
+        if (slot.owner.load() < 0)
+            continue;
+
+        writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + juce::String(i)
+                   + ",\"args\":{\"name\":\"Thread " + juce::String(i) + "\"}}");
+
+        // Only the last traceCapacity events survive in the ring.
+        auto written = slot.traceWritten.load(std::memory_order_acquire);
+        auto begin = written > (juce::uint64)traceCapacity ? written - (juce::uint64)traceCapacity : 0;
+
+        for (auto n = begin; n < written; ++n)
+        {
+            auto& event = slot.trace[(size_t)(n % traceCapacity)];
+
+            writeEvent("{\"name\":\"" + juce::String(getZoneName(event.zone))
+                       + "\",\"cat\":\"audiofx\",\"ph\":\"X\",\"pid\":0,\"tid\":" + juce::String(i)
+                       + ",\"ts\":" + juce::String(toMicroseconds(event.start - originCycles), 3)
+                       + ",\"dur\":" + juce::String(toMicroseconds(event.duration), 3) + "}");
+        }
+    }
+
+    stream << "\n]}\n";
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+juce::String Profiler::getSummary() const
+{
+    auto deadline = deadlineSeconds.load() * 1.0e6;
+
+    auto column = [](const juce::String& text, int width)
+    {
+        return text.paddedLeft(' ', width);
+    };
+
+    juce::String summary;
+    summary << "Block deadline: " << juce::String(deadline, 1) << " us\n\n"
+            << juce::String("thread").paddedRight(' ', 8) << juce::String("zone").paddedRight(' ', 20)
+            << column("count", 10) << column("p50 us", 12) << column("p99 us", 12) << column("max us", 12)
+            << column("p99 %", 10) << "\n";
+
+    for (int i = 0; slots != nullptr && i < maxThreads; ++i)
+    {
+        auto& slot = slots[i];
+
+        if (slot.owner.load() < 0)
+            continue;
+
+        for (int z = 0; z < numZones; ++z)
+        {
+            auto& histogram = slot.zones[z];
+            auto count = histogram.count.load();
+
+            if (count == 0)
+                continue;
+
+            auto p99 = toMicroseconds(histogram.getPercentile(0.99));
+
+            summary << juce::String(i).paddedRight(' ', 8) << juce::String(getZoneName((ProfileZone)z)).paddedRight(' ', 20)
+                    << column(juce::String((juce::int64)count), 10)
+                    << column(juce::String(toMicroseconds(histogram.getPercentile(0.5)), 2), 12)
+                    << column(juce::String(p99, 2), 12)
+                    << column(juce::String(toMicroseconds(histogram.maximum.load()), 2), 12)
+                    << column(deadline > 0.0 ? juce::String(p99 * 100.0 / deadline, 1) : juce::String("-"), 10) << "\n";
+        }
+
+        // Load is measured block by block, so it stays right when the block size changes.
+        if (slot.load.count.load() > 0)
+            summary << "\nThread " << i << " block load (% of deadline): p50 "
+                    << juce::String((double)slot.load.getPercentile(0.5) / 10.0, 1) << ", p99 "
+                    << juce::String((double)slot.load.getPercentile(0.99) / 10.0, 1) << ", max "
+                    << juce::String((double)slot.load.maximum.load() / 10.0, 1) << "\n\n";
+    }
+
+    return summary;
+}
+
+const char* Profiler::getZoneName(ProfileZone zone) noexcept
+{
+    switch (zone)
+    {
+        case ProfileZone::processBlock:       return "processBlock";
+        case ProfileZone::waveShape:          return "WaveShape";
+        case ProfileZone::filters:            return "Filters";
+        case ProfileZone::linearPhaseCuts:    return "LinearPhaseCuts";
+        case ProfileZone::reverb:             return "Reverberation";
+        case ProfileZone::modulation:         return "Modulation";
+        case ProfileZone::ducking:            return "Ducking";
+        case ProfileZone::updateDistortion:   return "updateDistortion";
+        case ProfileZone::updateLowCut:       return "updateLowCut";
+        case ProfileZone::updatePeak:         return "updatePeak";
+        case ProfileZone::updateHighCut:      return "updateHighCut";
+        case ProfileZone::updateReverb:       return "updateReverb";
+        case ProfileZone::updateOversampling: return "updateOversampling";
+        case ProfileZone::updateCutMode:      return "updateCutMode";
+        case ProfileZone::updateBypass:       return "updateBypass";
+        case ProfileZone::designFilters:      return "designFilters";
+        case ProfileZone::updateStageOrder:   return "updateStageOrder";
+        case ProfileZone::updateModulation:   return "updateModulation";
+        case ProfileZone::updateDucking:      return "updateDucking";
+        case ProfileZone::numZones:           break;
+    }
+
+    return "unknown";
+}
+
+//==============================================================================
+namespace
+{
+    // Log-linear buckets: exact below subBucketCount, then subBucketCount buckets
+    // per doubling, so every bucket is within 1/subBucketCount of its values.
+    int getBucket(juce::uint64 value) noexcept
+    {
+        if (value < (juce::uint64)subBucketCount)
+            return (int)value;
+
+        auto high = (juce::uint32)(value >> 32);
+        auto msb = high != 0 ? 32 + juce::findHighestSetBit(high) : juce::findHighestSetBit((juce::uint32)value);
+        auto sub = (int)(value >> (msb - Profiler::subBucketBits)) & (subBucketCount - 1);
+
+        return ((msb - Profiler::subBucketBits + 1) << Profiler::subBucketBits) + sub;
+    }
+}
+
+juce::uint64 Profiler::getBucketFloor(int bucket) noexcept
+{
+    if (bucket < subBucketCount)
+        return (juce::uint64)bucket;
+
+    auto msb = (bucket >> subBucketBits) - 1 + subBucketBits;
+    auto sub = bucket & (subBucketCount - 1);
+
+    return (juce::uint64)(subBucketCount + sub) << (msb - subBucketBits);
+}
+
+void Profiler::Histogram::clear() noexcept
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    count.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::Histogram::add(juce::uint64 value) noexcept
+{
+    // Single writer: load and store rather than read-modify-write.
+    auto& bucket = buckets[getBucket(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (value > maximum.load(std::memory_order_relaxed))
+        maximum.store(value, std::memory_order_relaxed);
+}
+
+juce::uint64 Profiler::Histogram::getPercentile(double proportion) const noexcept
+{
+    auto target = (juce::uint64)std::ceil(proportion * (double)count.load());
+    juce::uint64 seen = 0;
+
+    for (int b = 0; b < numBuckets; ++b)
+    {
+        seen += buckets[b].load(std::memory_order_relaxed);
+
+        if (seen >= target && seen > 0)
+            return juce::jmin(getBucketFloor(b), maximum.load());
+    }
+
+    return maximum.load();
+}
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    Profiler.h
+    Opt-in hot-path instrumentation. Scoped cycle-counter timers around each
+    stage and each coefficient update feed preallocated per-thread histograms
+    and a trace ring, which can be dumped as Chrome trace_event JSON and as a
+    summary table.
+
+    The scopes are only compiled in with AUDIOFX_PROFILING=1; otherwise
+    AUDIOFX_PROFILE_SCOPE expands to nothing. When compiled in but disabled,
+    each scope costs one relaxed atomic load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum class ProfileZone
+{
+    processBlock, waveShape, filters, linearPhaseCuts, reverb, modulation, ducking,
+    updateDistortion, updateLowCut, updatePeak, updateHighCut, updateReverb,
+    updateOversampling, updateCutMode, updateBypass, designFilters, updateStageOrder,
+    updateModulation, updateDucking,
+    numZones
+};
+
+class Profiler
+{
+public:
+    /// Threads beyond this many (the audio thread, the message thread and a couple
+    /// of host workers) aren't recorded.
+    static constexpr int maxThreads = 4;
+
+    /// Trace events kept per thread; older ones are overwritten.
+    static constexpr int traceCapacity = 1 << 16;
+
+    /// Histogram resolution: buckets per doubling of the duration.
+    static constexpr int subBucketBits = 3;
+    static constexpr int numBuckets = 64 << subBucketBits;
+
+    Profiler() = default;
+    ~Profiler();
+
+    /// Allocates the first time it's enabled and calibrates the cycle counter
+    /// against the high-resolution clock, blocking for a few milliseconds. Call from
+    /// the message thread, never from processBlock().
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const noexcept { return enabled.load(std::memory_order_acquire); }
+
+    /// Clears every histogram and trace. Only while disabled.
+    void clear();
+
+    /// What the processBlock zone is compared against: the current block's duration.
+    void setBlockDeadline(double seconds) noexcept;
+
+    static juce::uint64 readCycleCounter() noexcept;
+
+    /// Called by Scope on the thread being measured. Wait-free and allocation-free.
+    void record(ProfileZone zone, juce::uint64 startCycles, juce::uint64 endCycles) noexcept;
+
+    /// Every recorded event as Chrome trace_event JSON (chrome://tracing, Perfetto).
+    bool writeChromeTrace(const juce::File& file) const;
+
+    /// One row per thread and zone: count, p50, p99 and max, in microseconds and
+    /// as a share of the block deadline.
+    juce::String getSummary() const;
+
+    static const char* getZoneName(ProfileZone zone) noexcept;
+
+    class Scope
+    {
+    public:
+        Scope(Profiler& p, ProfileZone z) noexcept
+            : profiler(p), zone(z), startCycles(p.isEnabled() ? readCycleCounter() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (startCycles != 0)
+                profiler.record(zone, startCycles, readCycleCounter());
+        }
+
+    private:
+        Profiler& profiler;
+        const ProfileZone zone;
+        const juce::uint64 startCycles;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+private:
+    static constexpr int numZones = (int)ProfileZone::numZones;
+
+    // Each thread writes only its own slot, so plain relaxed loads and stores are
+    // enough; a dump taken while recording may be a few events behind.
+    struct Histogram
+    {
+        std::atomic<juce::uint32> buckets[numBuckets];
+        std::atomic<juce::uint64> count, maximum;
+
+        void clear() noexcept;
+        void add(juce::uint64 value) noexcept;
+        juce::uint64 getPercentile(double proportion) const noexcept;
+    };
+
+    struct TraceEvent
+    {
+        juce::uint64 start, duration;
+        ProfileZone zone;
+    };
+
+    struct ThreadSlot
+    {
+        std::atomic<int> owner{ -1 };
+        Histogram zones[numZones];
+
+        /// processBlock time over the deadline, in thousandths.
+        Histogram load;
+
+        std::vector<TraceEvent> trace;
+        std::atomic<juce::uint64> traceWritten{ 0 };
+    };
+
+    std::atomic<bool> enabled{ false };
+    std::unique_ptr<ThreadSlot[]> slots;
+
+    std::atomic<double> deadlineSeconds{ 0.0 };
+
+    // Cycle counter calibration, from setEnabled().
+    juce::uint64 originCycles = 0;
+    double cyclesPerSecond = 1.0;
+
+    ThreadSlot* getSlotForThisThread() noexcept;
+    static juce::uint64 getBucketFloor(int bucket) noexcept;
+    double toMicroseconds(juce::uint64 cycles) const noexcept { return (double)cycles * 1.0e6 / cyclesPerSecond; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Profiler)
+};
+
+#if AUDIOFX_PROFILING
+ #define AUDIOFX_PROFILE_SCOPE(profiler, zone) const Profiler::Scope JUCE_JOIN_MACRO(profileScope, __LINE__) (profiler, ProfileZone::zone)
+#else
+ #define AUDIOFX_PROFILE_SCOPE(profiler, zone)
+#endif
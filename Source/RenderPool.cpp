@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    RenderPool.cpp
+    Worker threads for offline renders. A stage hands over one task per
+    independent channel (or channel group); idle threads claim the next task as
+    they finish, and the calling thread works through the list alongside them.
+    Each task always computes the same samples whichever thread runs it, so the
+    output is bit-identical to the serial path.
+
+  ==============================================================================
+*/
+
+#include "RenderPool.h"
+
+RenderPool::Worker::Worker(RenderPool& p) : juce::Thread("AudioFX render worker"), pool(p)
+{
+}
+
+void RenderPool::Worker::run()
+{
+    while (! threadShouldExit())
+    {
+        wait(-1);
+
+        if (threadShouldExit())
+            break;
+
+        pool.runTasks();
+        pool.busyWorkers.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+//==============================================================================
+RenderPool::RenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this))->startThread();
+}
+
+RenderPool::~RenderPool()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto* worker : workers)
+    {
+        worker->notify();
+        worker->stopThread(4000);
+    }
+}
+
+int RenderPool::getDefaultNumWorkers() noexcept
+{
+    return juce::jmax(0, juce::SystemStats::getNumCpus() - 1);
+}
+
+void RenderPool::run(int count, TaskFunction function, void* context) noexcept
+{
+    // Workers still draining the last job would pick up this one half-written.
+    jassert(busyWorkers.load() == 0);
+
+    taskFunction = function;
+    taskContext = context;
+    numTasks = count;
+    nextTask.store(0, std::memory_order_relaxed);
+
+    // The caller takes a task too, so waking more than count - 1 would be wasted.
+    auto numToWake = juce::jmin(workers.size(), count - 1);
+    busyWorkers.store(numToWake, std::memory_order_release);
+
+    for (int i = 0; i < numToWake; ++i)
+        workers.getUnchecked(i)->notify();
+
+    runTasks();
+
+    // Every task has been claimed; wait for the ones still running elsewhere.
+    while (busyWorkers.load(std::memory_order_acquire) > 0)
+        juce::Thread::yield();
+}
+
+void RenderPool::runTasks() noexcept
+{
+    for (;;)
+    {
+        auto index = nextTask.fetch_add(1, std::memory_order_acq_rel);
+
+        if (index >= numTasks)
+            return;
+
+        taskFunction(taskContext, index);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    RenderPool.h
+    Worker threads for offline renders. A stage hands over one task per
+    independent channel (or channel group); idle threads claim the next task as
+    they finish, and the calling thread works through the list alongside them.
+    Each task always computes the same samples whichever thread runs it, so the
+    output is bit-identical to the serial path.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class RenderPool
+{
+public:
+    /// Starts the workers; allocates, so never from the audio thread.
+    explicit RenderPool(int numWorkers);
+    ~RenderPool();
+
+    /// One less than the number of cores, so the caller has a core of its own.
+    static int getDefaultNumWorkers() noexcept;
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    /// Runs task(i) for every i in [0, numTasks) and returns once all have finished.
+    /// Doesn't allocate or lock; the caller spins while the last tasks finish, which
+    /// is fine offline and the reason this is never used in realtime.
+    template <typename Task>
+    void forEach(int numTasks, Task& task) noexcept
+    {
+        run(numTasks, [](void* context, int index) { (*static_cast<Task*>(context))(index); }, &task);
+    }
+
+private:
+    using TaskFunction = void (*)(void* context, int index);
+
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(RenderPool& p);
+        void run() override;
+
+    private:
+        RenderPool& pool;
+    };
+
+    juce::OwnedArray<Worker> workers;
+
+    // The current job. Only written by run() while no worker is busy.
+    TaskFunction taskFunction = nullptr;
+    void* taskContext = nullptr;
+    int numTasks = 0;
+
+    std::atomic<int> nextTask{ 0 }, busyWorkers{ 0 };
+
+    void run(int numTasks, TaskFunction function, void* context) noexcept;
+    void runTasks() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderPool)
+};
+
+/// Runs task(i) for every i in [0, numTasks), on the pool when there is one.
+template <typename Task>
+void forEachTask(RenderPool* pool, int numTasks, Task&& task) noexcept
+{
+    if (pool != nullptr && numTasks > 1)
+    {
+        pool->forEach(numTasks, task);
+        return;
+    }
+
+    for (int i = 0; i < numTasks; ++i)
+        task(i);
+}
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    SidechainDucker.cpp
+    Follows the sidechain input's level and turns it into a per-sample gain
+    for the Reverberation stage's wet signal, so a vocal or a kick pushes the
+    tail down and it swells back in the gaps.
+
+  ==============================================================================
+*/
+
+#include "SidechainDucker.h"
+
+void SidechainDucker::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    maxBlockSize = maximumBlockSize;
+    gains.allocate((size_t)maximumBlockSize, true);
+    channelLevels.allocate((size_t)maximumBlockSize, true);
+    depth.reset(sampleRate, depthRampSeconds);
+
+    updateCoefficients();
+    reset();
+}
+
+void SidechainDucker::reset() noexcept
+{
+    envelope = 0.0f;
+    depth.setCurrentAndTargetValue(depth.getTargetValue());
+}
+
+void SidechainDucker::setTimes(float attack, float release) noexcept
+{
+    attackMilliseconds = attack;
+    releaseMilliseconds = release;
+    updateCoefficients();
+}
+
+void SidechainDucker::updateCoefficients() noexcept
+{
+    auto onePole = [this](float milliseconds)
+    {
+        return (float)(1.0 - std::exp(-1000.0 / (juce::jmax(0.01f, milliseconds) * sampleRate)));
+    };
+
+    attackCoefficient = onePole(attackMilliseconds);
+    releaseCoefficient = onePole(releaseMilliseconds);
+}
+
+const float* SidechainDucker::process(const juce::dsp::AudioBlock<const float>& sidechain) noexcept
+{
+    auto numSamples = (int)sidechain.getNumSamples();
+    auto numChannels = sidechain.getNumChannels();
+    jassert(numSamples <= maxBlockSize);
+
+    // Once the depth has ramped down to nothing the gain is 1 whatever the envelope
+    // says, so the detector is skipped and the envelope just releases towards zero,
+    // ready for the depth to come back.
+    if (! depth.isSmoothing() && depth.getTargetValue() <= 0.0f)
+    {
+        envelope *= std::pow(1.0f - releaseCoefficient, (float)numSamples);
+
+        if (envelope < silentEnvelope)
+            envelope = 0.0f;
+
+        return nullptr;
+    }
+
+    // The level detector runs a channel at a time with vector operations; only the
+    // envelope's one-pole is left as a scalar loop.
+    if (numChannels == 0)
+        juce::FloatVectorOperations::clear(gains, numSamples);
+    else
+        juce::FloatVectorOperations::abs(gains, sidechain.getChannelPointer(0), numSamples);
+
+    for (size_t ch = 1; ch < numChannels; ++ch)
+    {
+        juce::FloatVectorOperations::abs(channelLevels, sidechain.getChannelPointer(ch), numSamples);
+        juce::FloatVectorOperations::max(gains, gains, channelLevels, numSamples);
+    }
+
+    // Nothing coming in and nothing left to release: the wet signal goes untouched.
+    if (envelope < silentEnvelope && juce::FloatVectorOperations::findMaximum(gains.get(), numSamples) < silentEnvelope)
+    {
+        envelope = 0.0f;
+        depth.skip(numSamples);
+        return nullptr;
+    }
+
+    auto level = envelope;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        level += (gains[i] > level ? attackCoefficient : releaseCoefficient) * (gains[i] - level);
+        gains[i] = level;
+    }
+
+    envelope = level;
+
+    // 1 - depth * min(envelope, 1), with the depth ramped per sample while it moves.
+    juce::FloatVectorOperations::min(gains, gains, 1.0f, numSamples);
+
+    if (depth.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = 1.0f - depth.getNextValue() * gains[i];
+
+        return gains;
+    }
+
+    juce::FloatVectorOperations::multiply(gains, -depth.getTargetValue(), numSamples);
+    juce::FloatVectorOperations::add(gains, 1.0f, numSamples);
+    return gains;
+}
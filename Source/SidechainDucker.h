@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    SidechainDucker.h
+    Follows the sidechain input's level and turns it into a per-sample gain
+    for the Reverberation stage's wet signal, so a vocal or a kick pushes the
+    tail down and it swells back in the gaps.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class SidechainDucker
+{
+public:
+    static constexpr double depthRampSeconds = 0.05;
+
+    SidechainDucker() = default;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /// Lets the envelope fall straight to zero and finishes any depth ramp.
+    void reset() noexcept;
+
+    /// One-pole times for the envelope, which tracks the peak across the sidechain's
+    /// channels.
+    void setTimes(float attackMilliseconds, float releaseMilliseconds) noexcept;
+
+    /// How far a full-scale sidechain pulls the wet signal down: 0 leaves it alone,
+    /// 1 silences it. Changes ramp in over depthRampSeconds.
+    void setDepth(float newDepth) noexcept { depth.setTargetValue(newDepth); }
+
+    /// Reads the sidechain where the host left it. Returns one wet gain per sample, or
+    /// nullptr when nothing is being ducked this block: a depth that has ramped down to
+    /// nothing, or an envelope that has died away.
+    const float* process(const juce::dsp::AudioBlock<const float>& sidechain) noexcept;
+
+private:
+    double sampleRate = 44100.0;
+    juce::SmoothedValue<float> depth;
+    float envelope = 0.0f;
+    float attackCoefficient = 1.0f, releaseCoefficient = 1.0f;
+    float attackMilliseconds = 5.0f, releaseMilliseconds = 250.0f;
+
+    // gains doubles as the level detector's output before it becomes the gain curve.
+    juce::HeapBlock<float> gains, channelLevels;
+    int maxBlockSize = 0;
+
+    static constexpr float silentEnvelope = 1.0e-4f;
+
+    void updateCoefficients() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SidechainDucker)
+};
@@ -0,0 +1,353 @@
+/*
+  ==============================================================================
+
+    SpectrumView.cpp
+    Input and output spectra with the combined LowCut/Peak/HighCut response on
+    top. The FFTs and path building run on one background thread shared by every
+    open editor; the component only strokes finished paths.
+
+  ==============================================================================
+*/
+
+#include "SpectrumView.h"
+
+namespace
+{
+    // Every parameter the response curve depends on.
+    const char* const responseParameterIDs[] =
+    {
+        "LowCutoff", "LowCutSlope", "LowCutBypass", "PeakFreq", "PeakQuality", "PeakGain", "PeakBypass",
+        "HighCutoff", "HighCutSlope", "HighCutBypass"
+    };
+
+    // Spectrum bars fall this far per analysed frame once the level drops.
+    constexpr float releaseDecibelsPerFrame = 1.5f;
+}
+
+//==============================================================================
+SpectrumAnalyzer::AnalyzerThread::AnalyzerThread() : juce::TimeSliceThread("AudioFX analyzer")
+{
+    startThread();
+}
+
+SpectrumAnalyzer::AnalyzerThread::~AnalyzerThread()
+{
+    stopThread(2000);
+}
+
+SpectrumAnalyzer::Channel::Channel(SampleFifo& source)
+    : fifo(source),
+      history((size_t)fftSize, 0.0f),
+      fftData((size_t)fftSize * 2, 0.0f),
+      levels((size_t)fftSize / 2 + 1, minDecibels)
+{
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(AudioFXAudioProcessor& processor)
+    : audioProcessor(processor),
+      scratch((size_t)fftSize),
+      input(processor.getInputSamples()),
+      output(processor.getOutputSamples())
+{
+    thread->addTimeSliceClient(this);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    // Waits for a slice of ours that's already running to finish.
+    thread->removeTimeSliceClient(this);
+}
+
+void SpectrumAnalyzer::setSize(int newWidth, int newHeight) noexcept
+{
+    width = newWidth;
+    height = newHeight;
+}
+
+bool SpectrumAnalyzer::swapLatestPaths(juce::Path& inputPath, juce::Path& outputPath, juce::Path& response)
+{
+    const juce::SpinLock::ScopedLockType sl(readyLock);
+
+    auto changed = spectraReady || responseReady;
+
+    if (spectraReady)
+    {
+        inputPath.swapWithPath(readyInput);
+        outputPath.swapWithPath(readyOutput);
+        spectraReady = false;
+    }
+
+    if (responseReady)
+    {
+        response.swapWithPath(readyResponse);
+        responseReady = false;
+    }
+
+    return changed;
+}
+
+int SpectrumAnalyzer::useTimeSlice()
+{
+    const int frameInterval = 1000 / framesPerSecond;
+
+    if (! active)
+        return frameInterval;
+
+    auto w = width.load(), h = height.load();
+    auto sampleRate = audioProcessor.getSampleRate();
+
+    if (w <= 0 || h <= 0 || sampleRate <= 0.0)
+        return frameInterval;
+
+    auto resized = w != builtWidth || h != builtHeight;
+    builtWidth = w;
+    builtHeight = h;
+
+    auto newInput = analyse(input);
+    auto newOutput = analyse(output);
+    auto spectraChanged = newInput || newOutput || resized;
+
+    if (spectraChanged)
+    {
+        buildSpectrumPath(input, sampleRate, w, h);
+        buildSpectrumPath(output, sampleRate, w, h);
+    }
+
+    auto responseChanged = responseDirty.exchange(false) || resized || sampleRate != responseSampleRate;
+
+    if (responseChanged)
+    {
+        responseSampleRate = sampleRate;
+        buildResponsePath(sampleRate, w, h);
+    }
+
+    if (spectraChanged || responseChanged)
+    {
+        // Paths are rebuilt from scratch every time, so swapping hands them over
+        // without copying while the lock is held.
+        const juce::SpinLock::ScopedLockType sl(readyLock);
+
+        if (spectraChanged)
+        {
+            readyInput.swapWithPath(input.path);
+            readyOutput.swapWithPath(output.path);
+            spectraReady = true;
+        }
+
+        if (responseChanged)
+        {
+            readyResponse.swapWithPath(responsePath);
+            responseReady = true;
+        }
+    }
+
+    return frameInterval;
+}
+
+bool SpectrumAnalyzer::analyse(Channel& channel)
+{
+    // Keep the most recent fftSize samples, however many arrived.
+    auto received = false;
+
+    for (int numRead; (numRead = channel.fifo.pop(scratch.data(), fftSize)) > 0;)
+    {
+        std::move(channel.history.begin() + numRead, channel.history.end(), channel.history.begin());
+        std::copy(scratch.begin(), scratch.begin() + numRead, channel.history.end() - numRead);
+        received = true;
+    }
+
+    if (! received)
+        return false;
+
+    std::copy(channel.history.begin(), channel.history.end(), channel.fftData.begin());
+    window.multiplyWithWindowingTable(channel.fftData.data(), (size_t)fftSize);
+    fft.performFrequencyOnlyForwardTransform(channel.fftData.data());
+
+    // A full-scale sine reads 0 dB: the Hann window halves the amplitude, and the
+    // transform scales it by fftSize / 2.
+    auto scale = 4.0f / (float)fftSize;
+
+    for (size_t bin = 0; bin < channel.levels.size(); ++bin)
+    {
+        auto level = juce::Decibels::gainToDecibels(channel.fftData[bin] * scale, minDecibels);
+        channel.levels[bin] = juce::jmax(level, channel.levels[bin] - releaseDecibelsPerFrame);
+    }
+
+    return true;
+}
+
+void SpectrumAnalyzer::buildSpectrumPath(Channel& channel, double sampleRate, int w, int h) const
+{
+    auto& path = channel.path;
+    path.clear();
+    path.preallocateSpace(w * 3 + 6);
+
+    auto binsPerHz = (float)fftSize / (float)sampleRate;
+    auto lastBin = (float)(channel.levels.size() - 1);
+
+    for (int x = 0; x <= w; ++x)
+    {
+        // Linear interpolation between bins; at the bottom end a pixel spans less
+        // than a bin, at the top end many bins share a pixel and the loudest shows.
+        auto lowBin = juce::jlimit(0.0f, lastBin, getFrequency((float)x - 0.5f, w) * binsPerHz);
+        auto highBin = juce::jlimit(0.0f, lastBin, getFrequency((float)x + 0.5f, w) * binsPerHz);
+        auto level = minDecibels;
+
+        if (highBin - lowBin < 1.0f)
+        {
+            auto bin = (lowBin + highBin) * 0.5f;
+            auto index = juce::jmin((int)bin, (int)lastBin - 1);
+            auto fraction = bin - (float)index;
+            level = channel.levels[(size_t)index] + (channel.levels[(size_t)index + 1] - channel.levels[(size_t)index]) * fraction;
+        }
+        else
+        {
+            for (auto bin = (int)std::ceil(lowBin); bin <= (int)highBin; ++bin)
+                level = juce::jmax(level, channel.levels[(size_t)bin]);
+        }
+
+        auto y = juce::jmap(level, minDecibels, maxDecibels, (float)h, 0.0f);
+
+        if (x == 0)
+            path.startNewSubPath(0.0f, y);
+        else
+            path.lineTo((float)x, y);
+    }
+}
+
+void SpectrumAnalyzer::buildResponsePath(double sampleRate, int w, int h)
+{
+    auto settings = getChainSettings(audioProcessor.apvts);
+    std::vector<double> magnitudes((size_t)w + 1, 1.0);
+
+    auto applySection = [&]
+    {
+        for (int x = 0; x <= w; ++x)
+            magnitudes[(size_t)x] *= section->getMagnitudeForFrequency(getFrequency((float)x, w), sampleRate);
+    };
+
+    auto applyCascade = [&](auto designSection, float frequency, int numSections)
+    {
+        for (int i = 0; i < numSections; ++i)
+        {
+            designSection(*section, sampleRate, frequency, getCutSectionQ(numSections, i));
+            applySection();
+        }
+    };
+
+    // Bypassed stages drop out of the curve just as they drop out of the chain.
+    if (! settings.LowCutBypass)
+        applyCascade(designHighPass, settings.LowCutoff, settings.LowCutSlope + 1);
+
+    if (! settings.HighCutBypass)
+        applyCascade(designLowPass, settings.HighCutoff, settings.HighCutSlope + 1);
+
+    if (! settings.PeakBypass)
+    {
+        designPeak(*section, sampleRate, settings.PeakFreq, settings.PeakQuality, juce::Decibels::decibelsToGain(settings.PeakGain));
+        applySection();
+    }
+
+    responsePath.clear();
+    responsePath.preallocateSpace(w * 3 + 6);
+
+    for (int x = 0; x <= w; ++x)
+    {
+        auto decibels = juce::Decibels::gainToDecibels((float)magnitudes[(size_t)x], -responseRangeDecibels * 2.0f);
+        auto y = juce::jmap(decibels, -responseRangeDecibels, responseRangeDecibels, (float)h, 0.0f);
+
+        if (x == 0)
+            responsePath.startNewSubPath(0.0f, y);
+        else
+            responsePath.lineTo((float)x, y);
+    }
+}
+
+float SpectrumAnalyzer::getX(float frequency, int w) noexcept
+{
+    return (float)w * std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+}
+
+float SpectrumAnalyzer::getFrequency(float x, int w) noexcept
+{
+    return minFrequency * std::pow(maxFrequency / minFrequency, x / (float)juce::jmax(1, w));
+}
+
+//==============================================================================
+SpectrumView::SpectrumView(AudioFXAudioProcessor& processor)
+    : audioProcessor(processor), analyzer(processor)
+{
+    for (auto* id : responseParameterIDs)
+        audioProcessor.apvts.addParameterListener(id, this);
+
+    setOpaque(true);
+    startTimerHz(SpectrumAnalyzer::framesPerSecond);
+}
+
+SpectrumView::~SpectrumView()
+{
+    stopTimer();
+    audioProcessor.setAnalysisEnabled(false);
+
+    for (auto* id : responseParameterIDs)
+        audioProcessor.apvts.removeParameterListener(id, this);
+}
+
+void SpectrumView::paint(juce::Graphics& g)
+{
+    g.drawImageAt(grid, 0, 0);
+
+    g.setColour(juce::Colours::grey.withAlpha(0.6f));
+    g.strokePath(inputPath, juce::PathStrokeType(1.0f));
+
+    g.setColour(juce::Colours::lightblue);
+    g.strokePath(outputPath, juce::PathStrokeType(1.0f));
+
+    g.setColour(juce::Colours::white);
+    g.strokePath(responsePath, juce::PathStrokeType(2.0f));
+}
+
+void SpectrumView::resized()
+{
+    analyzer.setSize(getWidth(), getHeight());
+    renderGrid();
+}
+
+void SpectrumView::timerCallback()
+{
+    // A hidden or minimised editor stops both the capture and the analysis.
+    auto nowShowing = isShowing();
+
+    if (nowShowing != showing)
+    {
+        showing = nowShowing;
+        audioProcessor.setAnalysisEnabled(showing);
+        analyzer.setActive(showing);
+    }
+
+    if (showing && analyzer.swapLatestPaths(inputPath, outputPath, responsePath))
+        repaint();
+}
+
+void SpectrumView::parameterChanged(const juce::String&, float)
+{
+    analyzer.invalidateResponse();
+}
+
+void SpectrumView::renderGrid()
+{
+    auto w = juce::jmax(1, getWidth()), h = juce::jmax(1, getHeight());
+    grid = juce::Image(juce::Image::RGB, w, h, true);
+
+    juce::Graphics g(grid);
+    g.fillAll(juce::Colours::black);
+    g.setColour(juce::Colours::darkgrey);
+
+    for (auto frequency : { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f })
+    {
+        g.drawVerticalLine(juce::roundToInt(SpectrumAnalyzer::getX(frequency, w)), 0.0f, (float)h);
+    }
+
+    // The response curve's 0 dB line.
+    g.drawHorizontalLine(h / 2, 0.0f, (float)w);
+}
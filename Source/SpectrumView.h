@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    SpectrumView.h
+    Input and output spectra with the combined LowCut/Peak/HighCut response on
+    top. The FFTs and path building run on one background thread shared by every
+    open editor; the component only strokes finished paths.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+/** The analysis half. Drains the processor's sample FIFOs, runs windowed FFTs and
+    builds log-frequency paths sized for the view, at most framesPerSecond times a
+    second. The filter response is only rebuilt after invalidateResponse().
+*/
+class SpectrumAnalyzer : private juce::TimeSliceClient
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int framesPerSecond = 30;
+
+    static constexpr float minFrequency = 20.0f, maxFrequency = 20000.0f;
+    static constexpr float minDecibels = -96.0f, maxDecibels = 0.0f;
+
+    /// The response curve spans this many dB either side of the centre line.
+    static constexpr float responseRangeDecibels = 24.0f;
+
+    explicit SpectrumAnalyzer(AudioFXAudioProcessor& processor);
+    ~SpectrumAnalyzer() override;
+
+    /// The area the paths are built for. Any thread.
+    void setSize(int width, int height) noexcept;
+
+    /// Nothing is analysed while inactive. Any thread.
+    void setActive(bool shouldBeActive) noexcept { active = shouldBeActive; }
+
+    /// Marks the response curve stale. Any thread.
+    void invalidateResponse() noexcept { responseDirty = true; }
+
+    /// Swaps in whatever has been finished since the last call and returns whether
+    /// there was anything. Message thread only.
+    bool swapLatestPaths(juce::Path& input, juce::Path& output, juce::Path& response);
+
+    /// The log-frequency axis shared by the paths and the view's grid.
+    static float getX(float frequency, int width) noexcept;
+    static float getFrequency(float x, int width) noexcept;
+
+private:
+    struct Channel
+    {
+        explicit Channel(SampleFifo& source);
+
+        SampleFifo& fifo;
+        std::vector<float> history, fftData, levels;
+        juce::Path path;
+    };
+
+    /// One thread for every analyzer in the process.
+    struct AnalyzerThread : juce::TimeSliceThread
+    {
+        AnalyzerThread();
+        ~AnalyzerThread() override;
+    };
+
+    AudioFXAudioProcessor& audioProcessor;
+    juce::SharedResourcePointer<AnalyzerThread> thread;
+
+    juce::dsp::FFT fft{ fftOrder };
+    juce::dsp::WindowingFunction<float> window{ (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+    std::vector<float> scratch;
+    Channel input, output;
+
+    juce::Path responsePath;
+    Coefficients::Ptr section = makeBiquadStorage();
+    double responseSampleRate = 0.0;
+
+    std::atomic<int> width{ 0 }, height{ 0 };
+    std::atomic<bool> active{ false }, responseDirty{ true };
+    int builtWidth = 0, builtHeight = 0;
+
+    // Finished paths wait here for the message thread. The lock is only ever held
+    // for a swap, and never by the audio thread.
+    juce::SpinLock readyLock;
+    juce::Path readyInput, readyOutput, readyResponse;
+    bool spectraReady = false, responseReady = false;
+
+    int useTimeSlice() override;
+
+    bool analyse(Channel& channel);
+    void buildSpectrumPath(Channel& channel, double sampleRate, int w, int h) const;
+    void buildResponsePath(double sampleRate, int w, int h);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
+
+//==============================================================================
+class SpectrumView : public juce::Component,
+                     private juce::Timer,
+                     private juce::AudioProcessorValueTreeState::Listener
+{
+public:
+    /// Turns the processor's sample capture on while the view is showing.
+    explicit SpectrumView(AudioFXAudioProcessor& processor);
+    ~SpectrumView() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    AudioFXAudioProcessor& audioProcessor;
+    SpectrumAnalyzer analyzer;
+
+    // Everything painted is cached: the grid as an image rebuilt on resize, the
+    // curves as paths rebuilt by the analyzer.
+    juce::Image grid;
+    juce::Path inputPath, outputPath, responsePath;
+    bool showing = false;
+
+    void timerCallback() override;
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void renderGrid();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumView)
+};
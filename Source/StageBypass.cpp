@@ -0,0 +1,29 @@
+/*
+  ==============================================================================
+
+    StageBypass.cpp
+    Switches one stage of the chain in and out without clicks. A stage that has
+    faded all the way out isn't run at all; while it fades, its output is
+    crossfaded against its own input.
+
+  ==============================================================================
+*/
+
+#include "StageBypass.h"
+
+void StageBypass::prepare(double sampleRate, int maximumBlockSize)
+{
+    mix.reset(sampleRate, fadeSeconds);
+    gainsSize = maximumBlockSize;
+    gains.allocate((size_t)gainsSize, true);
+}
+
+const float* StageBypass::getNextGains(int numSamples) noexcept
+{
+    jassert(numSamples <= gainsSize);
+
+    for (int i = 0; i < numSamples; ++i)
+        gains[i] = mix.getNextValue();
+
+    return gains;
+}
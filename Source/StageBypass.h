@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    StageBypass.h
+    Switches one stage of the chain in and out without clicks. A stage that has
+    faded all the way out isn't run at all; while it fades, its output is
+    crossfaded against its own input.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class StageBypass
+{
+public:
+    static constexpr double fadeSeconds = 0.01;
+
+    StageBypass() = default;
+
+    /// Lands on the current target straight away; a fade in progress is dropped.
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /// Jumps to the end of any fade in progress.
+    void reset() noexcept { mix.setCurrentAndTargetValue(mix.getTargetValue()); }
+
+    /// Starts a fade towards bypassed or active. Audio thread only.
+    void setBypassed(bool shouldBeBypassed) noexcept { mix.setTargetValue(shouldBeBypassed ? 0.0f : 1.0f); }
+    bool isBypassed() const noexcept { return mix.getTargetValue() == 0.0f; }
+
+    /// Faded all the way out, so the stage needn't be processed.
+    bool isOff() const noexcept { return isBypassed() && ! mix.isSmoothing(); }
+    bool isFading() const noexcept { return mix.isSmoothing(); }
+
+    /// The stage's share of the output for each of the next numSamples samples.
+    /// Only meaningful while isFading(); advances the fade.
+    const float* getNextGains(int numSamples) noexcept;
+
+    /// Blends a stage's output with its input, sample by sample. SampleType may be a
+    /// SIMDRegister, in which case every lane gets the same gain.
+    template <typename SampleType>
+    static void crossfade(SampleType* wet, const SampleType* dry, const float* gains, size_t numSamples) noexcept
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+            wet[i] = dry[i] + (wet[i] - dry[i]) * gains[i];
+    }
+
+private:
+    juce::SmoothedValue<float> mix{ 1.0f };
+    juce::HeapBlock<float> gains;
+    int gainsSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StageBypass)
+};
@@ -0,0 +1,501 @@
+/*
+  ==============================================================================
+
+    StereoReverb.cpp
+    A single true-stereo Freeverb for the Reverberation stage. The sixteen comb
+    filters (eight per channel) run side by side in SIMDRegister lanes and share
+    one interleaved delay memory. At high session rates the tank can run at a
+    half or a quarter of the rate between half-band stages, with the dry path
+    left at the full rate.
+
+  ==============================================================================
+*/
+
+#include "StereoReverb.h"
+
+namespace
+{
+    // Freeverb's tunings at 44.1 kHz; the right tank is offset to decorrelate it.
+    const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+    const short allPassTunings[] = { 556, 441, 341, 225 };
+    const int stereoSpread = 23;
+
+    const float roomScaleFactor = 0.28f;
+    const float roomOffset = 0.7f;
+
+    const double smoothSeconds = 0.01;
+}
+
+void StereoReverb::AllPass::allocate(int maximumSize)
+{
+    capacity = juce::jmax(1, maximumSize);
+    buffer.calloc((size_t)capacity);
+    size = capacity;
+    index = 0;
+}
+
+void StereoReverb::AllPass::setSize(int newSize) noexcept
+{
+    size = juce::jlimit(1, capacity, newSize);
+    index = 0;
+}
+
+void StereoReverb::AllPass::clear() noexcept
+{
+    buffer.clear((size_t)size);
+}
+
+float StereoReverb::AllPass::process(float input) noexcept
+{
+    auto bufferedValue = buffer[index];
+    auto temp = input + (bufferedValue * 0.5f);
+    JUCE_UNDENORMALISE(temp);
+    buffer[index] = temp;
+
+    if (++index == size)
+        index = 0;
+
+    return bufferedValue - input;
+}
+
+//==============================================================================
+void StereoReverb::setParameters(const Parameters& newParameters) noexcept
+{
+    const float wetScaleFactor = 3.0f;
+    const float dryScaleFactor = 2.0f;
+
+    auto wet = newParameters.wetLevel * wetScaleFactor;
+    dryGain.setTargetValue(newParameters.dryLevel * dryScaleFactor);
+    wetGain1.setTargetValue(0.5f * wet * (1.0f + newParameters.width));
+    wetGain2.setTargetValue(0.5f * wet * (1.0f - newParameters.width));
+
+    gain = newParameters.freezeMode >= 0.5f ? 0.0f : 0.015f;
+    parameters = newParameters;
+    updateDamping();
+}
+
+void StereoReverb::updateDamping() noexcept
+{
+    const float dampScaleFactor = 0.4f;
+
+    if (parameters.freezeMode >= 0.5f)
+    {
+        damping.setTargetValue(0.0f);
+        feedback.setTargetValue(1.0f);
+    }
+    else
+    {
+        damping.setTargetValue(parameters.damping * dampScaleFactor);
+        feedback.setTargetValue(parameters.roomSize * roomScaleFactor + roomOffset);
+    }
+}
+
+double StereoReverb::getTailLengthSeconds(float roomSize, float thresholdDecibels) noexcept
+{
+    // The longest comb rings the longest: it loses the same number of dB on every
+    // trip round its loop, so the tail is that many trips. Damping only shortens the
+    // highs, and the all-passes add their own delay once on the way out.
+    auto feedbackLevel = juce::jlimit(roomOffset, roomOffset + roomScaleFactor, roomSize * roomScaleFactor + roomOffset);
+    auto trips = thresholdDecibels / (20.0 * std::log10((double)feedbackLevel));
+    auto longestComb = (combTunings[numCombsPerChannel - 1] + stereoSpread) / 44100.0;
+
+    auto allPassDelay = 0.0;
+
+    for (auto tuning : allPassTunings)
+        allPassDelay += (tuning + stereoSpread) / 44100.0;
+
+    return trips * longestComb + allPassDelay;
+}
+
+int StereoReverb::getReducedRateFactor(double sampleRate) noexcept
+{
+    auto factor = 1;
+
+    while (factor < maxReducedRateFactor && sampleRate / (factor * 2) >= minimumReducedRate)
+        factor *= 2;
+
+    return factor;
+}
+
+void StereoReverb::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    auto intSampleRate = (int)spec.sampleRate;
+    sampleRate = spec.sampleRate;
+    numChannels = juce::jlimit(1, 2, (int)spec.numChannels);
+
+    // The delays are longest at the full rate, so that's what everything is sized for.
+    combCapacity = 1;
+
+    for (int i = 0; i < numCombsPerChannel; ++i)
+        combCapacity = juce::jmax(combCapacity, (intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+
+    // One spare register's worth of bytes lets the frames start on a SIMD boundary.
+    combMemory.calloc((size_t)combCapacity * numCombLanes * sizeof(float) + sizeof(SIMDFloat));
+    combFrames = SIMDFloat::getNextSIMDAlignedPtr(reinterpret_cast<float*>(combMemory.get()));
+
+    for (int i = 0; i < numAllPasses; ++i)
+    {
+        allPasses[0][i].allocate((intSampleRate * allPassTunings[i]) / 44100);
+        allPasses[1][i].allocate((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+    }
+
+    // The half-band stages from the session rate down, and the tank's delay through
+    // them. The wet output is primed with just enough silence to make the round trip
+    // a whole number of tank samples, which the combs then read ahead by.
+    reducedFactor = getReducedRateFactor(sampleRate);
+    numStages = 0;
+
+    auto maxSamples = (int)spec.maximumBlockSize + reducedFactor;
+    auto latency = 0;
+
+    for (int factor = 1; factor < reducedFactor; factor *= 2, ++numStages)
+    {
+        auto stageRate = sampleRate / factor;
+        decimators[numStages].prepare(stageRate, passbandFrequency, stopbandDecibels, maxSamples / factor);
+
+        for (auto& interpolator : interpolators[numStages])
+            interpolator.prepare(stageRate, passbandFrequency, stopbandDecibels, maxSamples / factor);
+
+        latency += factor * (decimators[numStages].getDecimationLatency() + interpolators[numStages][0].getInterpolationLatency());
+    }
+
+    primedWet = reducedFactor - 1;
+
+    while ((latency + primedWet) % reducedFactor != 0)
+        ++primedWet;
+
+    reducedAdvance = (latency + primedWet) / reducedFactor;
+    reducedScratch.setSize(numReducedChannels, reducedFactor > 1 ? maxSamples + primedWet : 0);
+
+    dryGain.reset(spec.sampleRate, smoothSeconds);
+    wetGain1.reset(spec.sampleRate, smoothSeconds);
+    wetGain2.reset(spec.sampleRate, smoothSeconds);
+
+    setRateFactor(reducedRateRequested ? reducedFactor : 1);
+    reset();
+}
+
+void StereoReverb::setReducedRate(bool shouldReduce) noexcept
+{
+    reducedRateRequested = shouldReduce;
+    auto factor = shouldReduce ? reducedFactor : 1;
+
+    if (factor != rateFactor)
+    {
+        setRateFactor(factor);
+        reset();
+    }
+}
+
+void StereoReverb::setRateFactor(int factor) noexcept
+{
+    rateFactor = factor;
+
+    auto tankRate = sampleRate / factor;
+    auto intTankRate = (int)tankRate;
+
+    combLength = 1;
+
+    for (int i = 0; i < numCombsPerChannel; ++i)
+    {
+        combDelays[i] = juce::jmax(1, (intTankRate * combTunings[i]) / 44100);
+        combDelays[numCombsPerChannel + i] = juce::jmax(1, (intTankRate * (combTunings[i] + stereoSpread)) / 44100);
+        combLength = juce::jmax(combLength, combDelays[i], combDelays[numCombsPerChannel + i]);
+    }
+
+    jassert(combLength <= combCapacity);
+
+    combAdvance = factor > 1 ? reducedAdvance : 0;
+
+    for (int lane = 0; lane < numCombLanes; ++lane)
+    {
+        jassert(combDelays[lane] > combAdvance);
+        combTaps[lane] = combDelays[lane] - combAdvance;
+    }
+
+    for (int i = 0; i < numAllPasses; ++i)
+    {
+        allPasses[0][i].setSize((intTankRate * allPassTunings[i]) / 44100);
+        allPasses[1][i].setSize((intTankRate * (allPassTunings[i] + stereoSpread)) / 44100);
+    }
+
+    damping.reset(tankRate, smoothSeconds);
+    feedback.reset(tankRate, smoothSeconds);
+}
+
+void StereoReverb::reset() noexcept
+{
+    if (combFrames != nullptr)
+        std::fill(combFrames, combFrames + (size_t)combLength * numCombLanes, 0.0f);
+
+    for (auto& last : combLast)
+        last = SIMDFloat::expand(0.0f);
+
+    for (auto& channel : allPasses)
+        for (auto& allPass : channel)
+            allPass.clear();
+
+    writeFrame = 0;
+
+    for (int s = 0; s < numStages; ++s)
+    {
+        decimators[s].reset();
+
+        for (auto& interpolator : interpolators[s])
+            interpolator.reset();
+    }
+
+    reducedScratch.clear();
+    pendingInput = 0;
+    queuedWet = primedWet;
+}
+
+void StereoReverb::process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept
+{
+    auto& block = context.getOutputBlock();
+    auto numSamples = (int)block.getNumSamples();
+    const juce::ScopedValueSetter<const float*> modulation(wetModulation, wetModulation, nullptr);
+
+    if (rateFactor > 1 && block.getNumChannels() >= 1)
+        processReduced(block);
+    else if (numChannels == 2 && block.getNumChannels() >= 2)
+        processStereo(block.getChannelPointer(0), block.getChannelPointer(1), numSamples);
+    else if (block.getNumChannels() >= 1)
+        processMono(block.getChannelPointer(0), numSamples);
+}
+
+//==============================================================================
+template <int firstRegister, int numRegisters, bool advanced>
+StereoReverb::SIMDFloat StereoReverb::processCombs(float input, float damp, float feedbackLevel) noexcept
+{
+    constexpr int firstLane = firstRegister * lanesPerRegister;
+    constexpr int numLanes = numRegisters * lanesPerRegister;
+
+    auto read = [this](int delay, int lane)
+    {
+        auto readFrame = writeFrame - delay;
+
+        if (readFrame < 0)
+            readFrame += combLength;
+
+        return combFrames[readFrame * numCombLanes + lane];
+    };
+
+    // Each lane reads its own delay back from an older frame. This gather is the
+    // only per-comb scalar work left. An advanced tank gathers its outputs separately,
+    // from frames that haven't reached the feedback yet.
+    alignas(sizeof(SIMDFloat)) float delayed[numLanes];
+    alignas(sizeof(SIMDFloat)) float tapped[advanced ? numLanes : 1];
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        delayed[lane] = read(combDelays[firstLane + lane], firstLane + lane);
+
+        if constexpr (advanced)
+            tapped[lane] = read(combTaps[firstLane + lane], firstLane + lane);
+    }
+
+    auto* frame = combFrames + writeFrame * numCombLanes + firstLane;
+    auto vInput = SIMDFloat::expand(input);
+    auto vDamp = SIMDFloat::expand(damp);
+    auto vOneMinusDamp = SIMDFloat::expand(1.0f - damp);
+    auto vFeedback = SIMDFloat::expand(feedbackLevel);
+    auto sum = SIMDFloat::expand(0.0f);
+
+    for (int r = 0; r < numRegisters; ++r)
+    {
+        auto output = SIMDFloat::fromRawArray(delayed + r * lanesPerRegister);
+        auto& last = combLast[firstRegister + r];
+
+        last = output * vOneMinusDamp + last * vDamp;
+        (vInput + last * vFeedback).copyToRawArray(frame + r * lanesPerRegister);
+
+        if constexpr (advanced)
+            sum += SIMDFloat::fromRawArray(tapped + r * lanesPerRegister);
+        else
+            sum += output;
+    }
+
+    return sum;
+}
+
+void StereoReverb::processStereo(float* left, float* right, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto input = (left[i] + right[i]) * gain;
+        auto damp = damping.getNextValue();
+        auto feedbackLevel = feedback.getNextValue();
+
+        auto outL = processCombs<0, registersPerChannel>(input, damp, feedbackLevel).sum();
+        auto outR = processCombs<registersPerChannel, registersPerChannel>(input, damp, feedbackLevel).sum();
+
+        if (++writeFrame == combLength)
+            writeFrame = 0;
+
+        for (int j = 0; j < numAllPasses; ++j)
+        {
+            outL = allPasses[0][j].process(outL);
+            outR = allPasses[1][j].process(outR);
+        }
+
+        auto dry = dryGain.getNextValue();
+        auto duck = wetModulation != nullptr ? wetModulation[i] : 1.0f;
+        auto wet1 = wetGain1.getNextValue() * duck;
+        auto wet2 = wetGain2.getNextValue() * duck;
+
+        left[i] = outL * wet1 + outR * wet2 + left[i] * dry;
+        right[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+    }
+}
+
+void StereoReverb::processMono(float* samples, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto input = samples[i] * gain;
+        auto damp = damping.getNextValue();
+        auto feedbackLevel = feedback.getNextValue();
+
+        auto output = processCombs<0, registersPerChannel>(input, damp, feedbackLevel).sum();
+
+        if (++writeFrame == combLength)
+            writeFrame = 0;
+
+        for (int j = 0; j < numAllPasses; ++j)
+            output = allPasses[0][j].process(output);
+
+        auto dry = dryGain.getNextValue();
+        auto wet1 = wetGain1.getNextValue() * (wetModulation != nullptr ? wetModulation[i] : 1.0f);
+        wetGain2.skip(1);
+
+        samples[i] = output * wet1 + samples[i] * dry;
+    }
+}
+
+//==============================================================================
+void StereoReverb::processReduced(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numSamples = (int)block.getNumSamples();
+    auto stereo = numChannels == 2 && block.getNumChannels() >= 2;
+    auto* left = block.getChannelPointer(0);
+    auto* right = stereo ? block.getChannelPointer(1) : nullptr;
+
+    // The tank's mono input goes in after whatever didn't make a whole tank sample
+    // last time.
+    auto* input = reducedScratch.getWritePointer(reducedInput);
+    auto* newInput = input + pendingInput;
+
+    if (stereo)
+        juce::FloatVectorOperations::add(newInput, left, right, numSamples);
+    else
+        juce::FloatVectorOperations::copy(newInput, left, numSamples);
+
+    juce::FloatVectorOperations::multiply(newInput, gain, numSamples);
+
+    auto numAvailable = pendingInput + numSamples;
+    auto numTankSamples = numAvailable / rateFactor;
+    auto numConsumed = numTankSamples * rateFactor;
+
+    if (numTankSamples > 0)
+    {
+        const float* down = input;
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            auto* output = reducedScratch.getWritePointer(reducedDown0 + s);
+            decimators[s].decimate(down, output, numConsumed >> s);
+            down = output;
+        }
+
+        runTank(down, reducedScratch.getWritePointer(tankLeft), stereo ? reducedScratch.getWritePointer(tankRight) : nullptr,
+                numTankSamples);
+
+        // Back up a stage at a time; the last lands on the end of the wet queue.
+        for (int ch = 0; ch < (stereo ? 2 : 1); ++ch)
+        {
+            const float* up = reducedScratch.getReadPointer(tankLeft + ch);
+
+            for (int s = numStages; --s >= 0;)
+            {
+                auto* output = s == 0 ? reducedScratch.getWritePointer(wetLeft + ch) + queuedWet
+                                      : reducedScratch.getWritePointer(upLeft + ch);
+                interpolators[s][ch].interpolate(up, output, numTankSamples << (numStages - 1 - s));
+                up = output;
+            }
+        }
+
+        queuedWet += numConsumed;
+    }
+
+    pendingInput = numAvailable - numConsumed;
+    std::memmove(input, input + numConsumed, (size_t)pendingInput * sizeof(float));
+
+    // The dry signal and the wet gains stay at the full rate.
+    auto* wetL = reducedScratch.getReadPointer(wetLeft);
+    auto* wetR = reducedScratch.getReadPointer(wetRight);
+
+    if (stereo)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto dry = dryGain.getNextValue();
+            auto duck = wetModulation != nullptr ? wetModulation[i] : 1.0f;
+            auto wet1 = wetGain1.getNextValue() * duck;
+            auto wet2 = wetGain2.getNextValue() * duck;
+
+            left[i] = wetL[i] * wet1 + wetR[i] * wet2 + left[i] * dry;
+            right[i] = wetR[i] * wet1 + wetL[i] * wet2 + right[i] * dry;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto dry = dryGain.getNextValue();
+            auto wet1 = wetGain1.getNextValue() * (wetModulation != nullptr ? wetModulation[i] : 1.0f);
+
+            left[i] = wetL[i] * wet1 + left[i] * dry;
+        }
+
+        wetGain2.skip(numSamples);
+    }
+
+    jassert(queuedWet >= numSamples);
+    queuedWet -= numSamples;
+
+    for (int ch = 0; ch < (stereo ? 2 : 1); ++ch)
+    {
+        auto* wet = reducedScratch.getWritePointer(wetLeft + ch);
+        std::memmove(wet, wet + numSamples, (size_t)queuedWet * sizeof(float));
+    }
+}
+
+void StereoReverb::runTank(const float* input, float* left, float* right, int numSamples) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto damp = damping.getNextValue();
+        auto feedbackLevel = feedback.getNextValue();
+
+        auto outL = processCombs<0, registersPerChannel, true>(input[i], damp, feedbackLevel).sum();
+        auto outR = right != nullptr ? processCombs<registersPerChannel, registersPerChannel, true>(input[i], damp, feedbackLevel).sum()
+                                     : 0.0f;
+
+        if (++writeFrame == combLength)
+            writeFrame = 0;
+
+        for (int j = 0; j < numAllPasses; ++j)
+            outL = allPasses[0][j].process(outL);
+
+        left[i] = outL;
+
+        if (right != nullptr)
+        {
+            for (int j = 0; j < numAllPasses; ++j)
+                outR = allPasses[1][j].process(outR);
+
+            right[i] = outR;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    StereoReverb.h
+    A single true-stereo Freeverb for the Reverberation stage. The sixteen comb
+    filters (eight per channel) run side by side in SIMDRegister lanes and share
+    one interleaved delay memory. At high session rates the tank can run at a
+    half or a quarter of the rate between half-band stages, with the dry path
+    left at the full rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "HalfBandFilter.h"
+
+class StereoReverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int numCombsPerChannel = 8;
+    static constexpr int numAllPasses = 4;
+
+    /// A reduced-rate tank never runs below this, and its resampling is flat up to
+    /// passbandFrequency.
+    static constexpr double minimumReducedRate = 48000.0;
+    static constexpr double passbandFrequency = 20000.0;
+    static constexpr double stopbandDecibels = -70.0;
+    static constexpr int maxReducedRateFactor = 4;
+
+    StereoReverb() = default;
+
+    /// Same mapping as juce::Reverb, so presets sound as before: Width crossfeeds the
+    /// two decorrelated tails instead of just scaling the wet level.
+    void setParameters(const Parameters& newParameters) noexcept;
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    /// A per-sample gain on the wet signal, for the next process() call only. nullptr
+    /// for none.
+    void setWetModulation(const float* gains) noexcept { wetModulation = gains; }
+
+    /// How long the tail takes to fall thresholdDecibels (a negative number) below the
+    /// input for a given roomSize, at any sample rate.
+    static double getTailLengthSeconds(float roomSize, float thresholdDecibels) noexcept;
+
+    /// spec.numChannels may be 1 (left tank only) or 2. Allocates for both the full
+    /// and the reduced rate.
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    /// Runs the tank at sampleRate / getReducedRateFactor(sampleRate), so a tail that
+    /// carries nothing above passbandFrequency isn't computed at 96 or 192 kHz. The
+    /// wet signal comes back up aligned sample for sample with the dry one: the tank
+    /// reads its combs ahead by exactly the resampling latency. Switching clears the
+    /// tail. Safe to call from the audio thread.
+    void setReducedRate(bool shouldReduce) noexcept;
+    bool isReducedRate() const noexcept { return rateFactor > 1; }
+
+    /// 1, 2 or 4: the largest that keeps the tank at minimumReducedRate or above.
+    static int getReducedRateFactor(double sampleRate) noexcept;
+
+    void process(const juce::dsp::ProcessContextReplacing<float>& context) noexcept;
+
+private:
+    static constexpr int numCombLanes = numCombsPerChannel * 2;
+    static constexpr int lanesPerRegister = (int)SIMDFloat::SIMDNumElements;
+    static constexpr int registersPerChannel = numCombsPerChannel / lanesPerRegister;
+    static constexpr int numCombRegisters = numCombLanes / lanesPerRegister;
+
+    static_assert(numCombsPerChannel % lanesPerRegister == 0, "comb lanes must fill whole registers");
+
+    struct AllPass
+    {
+        juce::HeapBlock<float> buffer;
+        int capacity = 1, size = 1, index = 0;
+
+        void allocate(int maximumSize);
+        void setSize(int newSize) noexcept;
+        void clear() noexcept;
+        float process(float input) noexcept;
+    };
+
+    Parameters parameters;
+    float gain = 0.015f;
+    juce::SmoothedValue<float> damping, feedback, dryGain, wetGain1, wetGain2;
+    const float* wetModulation = nullptr;
+
+    // combFrames holds combLength frames of numCombLanes samples: every comb writes
+    // into the current frame with one aligned store per register and reads back its
+    // own delay from an older frame. Lanes [0, 8) are the left tank, [8, 16) the right.
+    // The memory is sized for the full rate; a reduced-rate tank uses less of it.
+    juce::HeapBlock<char> combMemory;
+    float* combFrames = nullptr;
+    int combCapacity = 0, combLength = 0, writeFrame = 0;
+    int combDelays[numCombLanes] = {};
+    SIMDFloat combLast[numCombRegisters];
+
+    // At a reduced rate the combs' outputs are read combAdvance frames earlier than
+    // their feedback, which is the same signal combAdvance samples sooner.
+    int combTaps[numCombLanes] = {};
+    int combAdvance = 0;
+
+    AllPass allPasses[2][numAllPasses];
+    int numChannels = 2;
+    double sampleRate = 44100.0;
+
+    // The reduced-rate path. Stage 0 is at the session rate. The input keeps whatever
+    // didn't fill a whole tank sample, and the wet output starts with primedWet samples
+    // of silence so a block can always be filled from it.
+    enum ReducedChannel
+    {
+        reducedInput, reducedDown0, reducedDown1, tankLeft, tankRight, upLeft, upRight, wetLeft, wetRight, numReducedChannels
+    };
+
+    static constexpr int maxStages = 2;
+
+    HalfBandFilter decimators[maxStages];
+    HalfBandFilter interpolators[maxStages][2];
+    juce::AudioBuffer<float> reducedScratch;
+    int rateFactor = 1, reducedFactor = 1, numStages = 0, reducedAdvance = 0;
+    int pendingInput = 0, queuedWet = 0, primedWet = 0;
+    bool reducedRateRequested = false;
+
+    void setRateFactor(int factor) noexcept;
+    void updateDamping() noexcept;
+    void processStereo(float* left, float* right, int numSamples) noexcept;
+    void processMono(float* samples, int numSamples) noexcept;
+    void processReduced(const juce::dsp::AudioBlock<float>& block) noexcept;
+    void runTank(const float* input, float* left, float* right, int numSamples) noexcept;
+
+    template <int firstRegister, int numRegisters, bool advanced = false>
+    SIMDFloat processCombs(float input, float damp, float feedbackLevel) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoReverb)
+};
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Telemetry.cpp
+    What processBlock() reports about each block, and the wait-free
+    single-producer/single-consumer queues that carry it and the raw audio for
+    the spectrum analyzer to the editor.
+
+  ==============================================================================
+*/
+
+#include "Telemetry.h"
+
+bool TelemetryQueue::push(const TelemetryFrame& frame) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    frames[size1 > 0 ? start1 : start2] = frame;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool TelemetryQueue::pop(TelemetryFrame& frame) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    frame = frames[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+SampleFifo::SampleFifo()
+{
+    samples.calloc((size_t)capacity);
+}
+
+void SampleFifo::push(const juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto numChannels = block.getNumChannels();
+    auto scale = 1.0f / (float)juce::jmax((size_t)1, numChannels);
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite((int)block.getNumSamples(), start1, size1, start2, size2);
+
+    auto mixDown = [&](int destStart, int sourceStart, int numSamples)
+    {
+        auto* dest = samples + destStart;
+        juce::FloatVectorOperations::copyWithMultiply(dest, block.getChannelPointer(0) + sourceStart, scale, numSamples);
+
+        for (size_t ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::addWithMultiply(dest, block.getChannelPointer(ch) + sourceStart, scale, numSamples);
+    };
+
+    if (numChannels > 0)
+    {
+        mixDown(start1, 0, size1);
+        mixDown(start2, size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+int SampleFifo::pop(float* dest, int maxSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    juce::FloatVectorOperations::copy(dest, samples + start1, size1);
+    juce::FloatVectorOperations::copy(dest + size1, samples + start2, size2);
+
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Telemetry.h
+    What processBlock() reports about each block, and the wait-free
+    single-producer/single-consumer queues that carry it and the raw audio for
+    the spectrum analyzer to the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct TelemetryFrame
+{
+    static constexpr int maxChannels = 16;
+
+    int numChannels = 0;
+    float inputPeak[maxChannels] = {}, inputRms[maxChannels] = {};
+    float outputPeak[maxChannels] = {}, outputRms[maxChannels] = {};
+
+    /// How far the waveshaper held the block's peak below drive times the input
+    /// peak, in dB. Never positive; 0 when nothing was shaped.
+    float gainReductionDecibels = 0.0f;
+
+    /// Wall-clock time spent in processBlock(), and that over the block's duration.
+    float blockMilliseconds = 0.0f, cpuLoad = 0.0f;
+};
+
+/** A fixed ring of frames. push() is only ever called from the audio thread and
+    pop() only from the message thread; neither locks, waits or allocates.
+*/
+class TelemetryQueue
+{
+public:
+    static constexpr int capacity = 128;
+
+    TelemetryQueue() = default;
+
+    /// Returns false, dropping the frame, if the reader has fallen a full ring behind.
+    bool push(const TelemetryFrame& frame) noexcept;
+    bool pop(TelemetryFrame& frame) noexcept;
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    TelemetryFrame frames[capacity];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TelemetryQueue)
+};
+
+//==============================================================================
+/** Raw audio for the analyzer, mixed down to mono. Same threading rules as
+    TelemetryQueue: the audio thread pushes, one reader thread pops.
+*/
+class SampleFifo
+{
+public:
+    static constexpr int capacity = 1 << 15;
+
+    SampleFifo();
+
+    /// Whatever doesn't fit is dropped; the analyzer only ever looks at recent audio.
+    void push(const juce::dsp::AudioBlock<float>& block) noexcept;
+
+    /// Copies up to maxSamples of the oldest audio into dest and returns how many.
+    int pop(float* dest, int maxSamples) noexcept;
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    juce::HeapBlock<float> samples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleFifo)
+};
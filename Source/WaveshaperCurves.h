@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    WaveshaperCurves.h
+    The transfer curves available to the WaveShape stage. Each curve is a
+    functor whose apply() is a template over float and SIMDRegister<float>, so
+    the same expression drives both the scalar edges and the vector body of a
+    block and the curve is chosen once per block rather than once per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum class WaveshaperCurve
+{
+    tanh, softClip, hardClip, tube, foldback
+};
+
+namespace WaveshaperMath
+{
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+
+    inline float clamp(float x, float limit) noexcept            { return juce::jlimit(-limit, limit, x); }
+    inline SIMDFloat clamp(SIMDFloat x, float limit) noexcept    { return SIMDFloat::min(SIMDFloat::max(x, SIMDFloat::expand(-limit)), SIMDFloat::expand(limit)); }
+
+    inline float absolute(float x) noexcept                      { return std::abs(x); }
+    inline SIMDFloat absolute(SIMDFloat x) noexcept              { return SIMDFloat::max(x, SIMDFloat::expand(0.0f) - x); }
+
+    // SIMDRegister has no division or floor, so these reach for the native
+    // instructions and fall back to a per-lane loop elsewhere.
+    inline float divide(float a, float b) noexcept               { return a / b; }
+    inline SIMDFloat divide(SIMDFloat a, SIMDFloat b) noexcept
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        return SIMDFloat::fromNative(_mm_div_ps(a.value, b.value));
+       #elif JUCE_USE_ARM_NEON && defined (__aarch64__)
+        return SIMDFloat::fromNative(vdivq_f32(a.value, b.value));
+       #else
+        for (size_t i = 0; i < SIMDFloat::size(); ++i)
+            a.set(i, a.get(i) / b.get(i));
+
+        return a;
+       #endif
+    }
+
+    inline float floor(float x) noexcept                         { return std::floor(x); }
+    inline SIMDFloat floor(SIMDFloat x) noexcept
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        // Truncate, then step down by one wherever truncation rounded a negative value up.
+        auto truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x.value));
+        auto roundedUp = _mm_and_ps(_mm_cmpgt_ps(truncated, x.value), _mm_set1_ps(1.0f));
+        return SIMDFloat::fromNative(_mm_sub_ps(truncated, roundedUp));
+       #elif JUCE_USE_ARM_NEON && defined (__aarch64__)
+        return SIMDFloat::fromNative(vrndmq_f32(x.value));
+       #else
+        for (size_t i = 0; i < SIMDFloat::size(); ++i)
+            x.set(i, std::floor(x.get(i)));
+
+        return x;
+       #endif
+    }
+}
+
+//==============================================================================
+/** tanh(x) from the [7/6] Pade approximant, with the input clamped at the point
+    where the approximant is closest to 1.
+    Max absolute error against std::tanh is 7.0e-5 (about -83 dB) for all x.
+*/
+struct TanhCurve
+{
+    static constexpr float inputLimit = 4.783f;
+
+    template <typename T>
+    static T apply(T x) noexcept
+    {
+        x = WaveshaperMath::clamp(x, inputLimit);
+        auto x2 = x * x;
+        auto numerator = x * (((x2 + 378.0f) * x2 + 17325.0f) * x2 + 135135.0f);
+        auto denominator = ((x2 * 28.0f + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+        return WaveshaperMath::divide(numerator, denominator);
+    }
+};
+
+/** Cubic soft clipper: 1.5x - 0.5x^3 inside [-1, 1], flat outside.
+    Exact, so the only error is float rounding.
+*/
+struct SoftClipCurve
+{
+    template <typename T>
+    static T apply(T x) noexcept
+    {
+        x = WaveshaperMath::clamp(x, 1.0f);
+        return x * (x * x * -0.5f + 1.5f);
+    }
+};
+
+/** Clamps to [-1, 1]. Exact. */
+struct HardClipCurve
+{
+    template <typename T>
+    static T apply(T x) noexcept
+    {
+        return WaveshaperMath::clamp(x, 1.0f);
+    }
+};
+
+/** Biased tanh, tanh(x + b) - tanh(b). It saturates earlier on the positive side,
+    which adds the even harmonics of a single-ended tube stage, and maps silence
+    to silence. Built on TanhCurve, so the error bound is the same 7.0e-5.
+*/
+struct TubeCurve
+{
+    static constexpr float bias = 0.25f;
+    static constexpr float biasOffset = 0.24491866f; // tanh(0.25)
+
+    template <typename T>
+    static T apply(T x) noexcept
+    {
+        return TanhCurve::apply(x + bias) - biasOffset;
+    }
+};
+
+/** Triangle foldback: the signal follows x inside [-1, 1] and is reflected off
+    +-1 beyond that, however hard it is driven. Exact apart from float rounding.
+*/
+struct FoldbackCurve
+{
+    template <typename T>
+    static T apply(T x) noexcept
+    {
+        // |((x - 1) mod 4) - 2| - 1, with mod built from floor so it also holds below zero.
+        auto shifted = x - 1.0f;
+        auto wrapped = shifted - WaveshaperMath::floor(shifted * 0.25f) * 4.0f;
+        return WaveshaperMath::absolute(wrapped - 2.0f) - 1.0f;
+    }
+};
+
+//==============================================================================
+/** Applies Curve to drive * x over a channel in place: scalar up to the first
+    SIMD-aligned sample, whole registers through the middle, scalar for the tail.
+*/
+template <typename Curve>
+void applyCurve(float* samples, size_t numSamples, float drive) noexcept
+{
+    using SIMDFloat = WaveshaperMath::SIMDFloat;
+
+    auto* end = samples + numSamples;
+    auto* alignedStart = juce::jmin(SIMDFloat::getNextSIMDAlignedPtr(samples), end);
+
+    for (; samples < alignedStart; ++samples)
+        *samples = Curve::apply(drive * *samples);
+
+    auto vectorDrive = SIMDFloat::expand(drive);
+
+    for (; samples + SIMDFloat::size() <= end; samples += SIMDFloat::size())
+        Curve::apply(SIMDFloat::fromRawArray(samples) * vectorDrive).copyToRawArray(samples);
+
+    for (; samples < end; ++samples)
+        *samples = Curve::apply(drive * *samples);
+}
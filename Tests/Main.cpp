@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Runs the AudioFX unit tests headless: the real-time safety audit of
+    processBlock() and the null tests of the optimised DSP kernels. Exits
+    non-zero if any test failed, so ctest picks the result up.
+
+    Usage:
+      AudioFXTests [options]
+
+      --test <name>             Only run the named test ("Real-time safety" or
+                                "Null tests"; default: all)
+      --seed <n>                Seed for the test signals (default: random, and
+                                printed so a failure can be reproduced)
+      --abort-on-violation      Abort at the first allocation or lock an audit
+                                sees, so a debugger stops on the offending call
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "RealtimeAudit.h"
+
+#include <iostream>
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: AudioFXTests [--test <name>] [--seed <n>] [--abort-on-violation]" << std::endl;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The processors' parameter trees start timers, which need a message manager
+    // even though nothing here ever opens a window.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::String testName;
+    auto seed = juce::Random::getSystemRandom().nextInt64();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String arg(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--test" && hasValue)            testName = argv[++i];
+        else if (arg == "--seed" && hasValue)       seed = juce::String(argv[++i]).getLargeIntValue();
+        else if (arg == "--abort-on-violation")     RealtimeAudit::setAbortOnViolation(true);
+        else
+        {
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::cout << "Seed " << seed << std::endl;
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    if (testName.isEmpty())
+    {
+        runner.runAllTests(seed);
+    }
+    else
+    {
+        juce::Array<juce::UnitTest*> tests;
+
+        for (auto* test : juce::UnitTest::getAllTests())
+            if (test->getName() == testName)
+                tests.add(test);
+
+        if (tests.isEmpty())
+        {
+            std::cerr << "no test called " << testName << std::endl;
+            return 2;
+        }
+
+        runner.runTests(tests, seed);
+    }
+
+    auto numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+
+    std::cout << (numFailures == 0 ? "All tests passed" : juce::String(numFailures) + " failures") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,957 @@
+/*
+  ==============================================================================
+
+    NullTests.cpp
+    Renders test signals through each optimised DSP kernel and through a plain
+    scalar reference (double precision where the kernel runs in float), and
+    checks that the difference stays below a stated level. Every tolerance is
+    the largest error allowed on any sample, in dB relative to full scale. The
+    input signals stay within +-1, but the outputs needn't: the +24 dB Peak
+    regions reach about 16 times full scale.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "WaveshaperCurves.h"
+#include "DistortionStage.h"
+#include "LockstepChain.h"
+#include "LinearPhaseCuts.h"
+#include "PartitionedConvolver.h"
+#include "StereoReverb.h"
+#include "HalfBandFilter.h"
+#include "SidechainDucker.h"
+
+namespace Tolerance
+{
+    // The Pade tanh is within 7.0e-5 of std::tanh, about -83 dB.
+    constexpr double approximateCurve = -80.0;
+    constexpr double exactCurve = -100.0;
+
+    // The same oversampler on both sides, so only the curve's float rounding is left.
+    constexpr double oversampledCurve = -100.0;
+
+    // Float TPT sections against double biquads of the same design.
+    constexpr double filterChain = -90.0;
+
+    // Float FFT partitions against a double direct-form sum.
+    constexpr double convolution = -90.0;
+
+    // A float FIR design through juce::dsp::Convolution against a double design summed
+    // directly. The kernel samples float biquad coefficients, which near DC drift most
+    // for the steep 20 Hz cascades: about -70 dB.
+    constexpr double linearPhaseCuts = -60.0;
+
+    // Only the order of the comb sums differs from juce::Reverb.
+    constexpr double reverb = -90.0;
+
+    // Down and up again through two -70 dB half-bands: the passband ripple, twice.
+    constexpr double halfBandRoundTrip = -60.0;
+
+    // The dry path never goes near the resampled tank.
+    constexpr double reducedRateDryPath = -120.0;
+
+    // The same half-bands and tank, in one pass and at the tank's own rate.
+    constexpr double reducedRateWetPath = -90.0;
+}
+
+namespace
+{
+    /// Transposed direct form II in double, one section per stage of the reference.
+    struct ReferenceBiquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+        double s1 = 0.0, s2 = 0.0;
+
+        // The cookbook designs, which the chain's sections are specified to match.
+        static ReferenceBiquad highPass(double sampleRate, double frequency, double q)
+        {
+            auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+            auto c1 = 1.0 / (1.0 + n / q + n * n);
+            return { c1 * n * n, -2.0 * c1 * n * n, c1 * n * n, 2.0 * c1 * (1.0 - n * n), c1 * (1.0 - n / q + n * n) };
+        }
+
+        static ReferenceBiquad lowPass(double sampleRate, double frequency, double q)
+        {
+            auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+            auto c1 = 1.0 / (1.0 + n / q + n * n);
+            return { c1, 2.0 * c1, c1, 2.0 * c1 * (1.0 - n * n), c1 * (1.0 - n / q + n * n) };
+        }
+
+        static ReferenceBiquad peak(double sampleRate, double frequency, double q, double gainFactor)
+        {
+            auto a = std::sqrt(gainFactor);
+            auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+            auto alpha = std::sin(omega) / (2.0 * q);
+            auto c2 = -2.0 * std::cos(omega);
+            auto a0 = 1.0 + alpha / a;
+            return { (1.0 + alpha * a) / a0, c2 / a0, (1.0 - alpha * a) / a0, c2 / a0, (1.0 - alpha / a) / a0 };
+        }
+
+        /// |H| at omega radians per sample.
+        double getMagnitude(double omega) const noexcept
+        {
+            auto z1 = std::polar(1.0, -omega), z2 = z1 * z1;
+            return std::abs((b0 + b1 * z1 + b2 * z2) / (1.0 + a1 * z1 + a2 * z2));
+        }
+
+        double process(double x) noexcept
+        {
+            auto y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    /// One setting of the LowCut, Peak and HighCut stages.
+    struct FilterRegion
+    {
+        float lowCut, highCut;
+        int numSections;
+        float peakFrequency, peakQuality, peakDecibels;
+
+        juce::String describe() const
+        {
+            return "cuts " + juce::String(lowCut) + "/" + juce::String(highCut) + " Hz x" + juce::String(numSections)
+                 + ", peak " + juce::String(peakFrequency) + " Hz Q " + juce::String(peakQuality) + " "
+                 + juce::String(peakDecibels) + " dB";
+        }
+    };
+
+    std::vector<ReferenceBiquad> makeReferenceChain(const FilterRegion& region, double sampleRate)
+    {
+        std::vector<ReferenceBiquad> sections;
+
+        for (int i = 0; i < region.numSections; ++i)
+            sections.push_back(ReferenceBiquad::highPass(sampleRate, region.lowCut, getCutSectionQ(region.numSections, i)));
+
+        sections.push_back(ReferenceBiquad::peak(sampleRate, region.peakFrequency, region.peakQuality,
+                                                 juce::Decibels::decibelsToGain((double)region.peakDecibels)));
+
+        for (int i = 0; i < region.numSections; ++i)
+            sections.push_back(ReferenceBiquad::lowPass(sampleRate, region.highCut, getCutSectionQ(region.numSections, i)));
+
+        return sections;
+    }
+
+    void designChain(const FilterRegion& region, double sampleRate, LockstepChain::CutCoefficients& lowCut,
+                     SVFCoefficients& peak, LockstepChain::CutCoefficients& highCut)
+    {
+        for (int i = 0; i < region.numSections; ++i)
+        {
+            designSVFHighPass(lowCut[(size_t)i], sampleRate, region.lowCut, getCutSectionQ(region.numSections, i));
+            designSVFLowPass(highCut[(size_t)i], sampleRate, region.highCut, getCutSectionQ(region.numSections, i));
+        }
+
+        designSVFPeak(peak, sampleRate, region.peakFrequency, region.peakQuality,
+                      juce::Decibels::decibelsToGain(region.peakDecibels));
+    }
+
+    /// White noise at half scale, with a full-scale click every so often.
+    void fillNoise(juce::AudioBuffer<float>& buffer, juce::Random& random)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(ch, i, i % 1999 == 0 ? 1.0f : random.nextFloat() - 0.5f);
+    }
+
+    /// Largest difference on any sample, in dB relative to full scale.
+    double getErrorDecibels(const float* actual, const double* reference, int numSamples) noexcept
+    {
+        auto error = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto difference = std::abs((double)actual[i] - reference[i]);
+            error = std::isnan(difference) ? std::numeric_limits<double>::infinity() : juce::jmax(error, difference);
+        }
+
+        return juce::Decibels::gainToDecibels(error, -400.0);
+    }
+
+    double getErrorDecibels(const float* actual, const float* reference, int numSamples)
+    {
+        std::vector<double> widened(reference, reference + numSamples);
+        return getErrorDecibels(actual, widened.data(), numSamples);
+    }
+
+    double clampFrequency(double sampleRate, double frequency) noexcept
+    {
+        return juce::jmin(frequency, 0.499 * sampleRate);
+    }
+}
+
+//==============================================================================
+class NullTests : public juce::UnitTest
+{
+public:
+    NullTests() : juce::UnitTest("Null tests", "AudioFX") {}
+
+    void runTest() override
+    {
+        testWaveshaperCurves();
+        testOversampledDistortion();
+        testFilterChain();
+        testTunedFilterChain();
+        testFilterChainBypassFade();
+        testDuckerDepthRamp();
+        testPartitionedConvolver();
+        testLinearPhaseCuts();
+        testStereoReverb();
+        testHalfBandRoundTrip();
+        testReducedRateDryPath();
+        testReducedRateWetPath();
+    }
+
+private:
+    static constexpr double sampleRates[] = { 44100.0, 96000.0, 192000.0 };
+    static constexpr int blockSize = 512;
+
+    void expectNull(double errorDecibels, double toleranceDecibels, const juce::String& what)
+    {
+        expect(errorDecibels <= toleranceDecibels,
+               what + ": error " + juce::String(errorDecibels, 1) + " dB, tolerance " + juce::String(toleranceDecibels, 1) + " dB");
+    }
+
+    //==============================================================================
+    template <typename Curve, typename Reference>
+    void checkCurve(const char* name, Reference reference, double toleranceDecibels)
+    {
+        // A sweep from -1 to 1 with noise on top. Starting one sample past an aligned
+        // address, with an odd length, runs both scalar edges as well as the SIMD body.
+        constexpr int numSamples = 4099;
+        juce::HeapBlock<float> storage((size_t)numSamples + 16);
+        auto* input = WaveshaperMath::SIMDFloat::getNextSIMDAlignedPtr(storage.get()) + 1;
+        auto& random = getRandom();
+
+        for (int i = 0; i < numSamples; ++i)
+            input[i] = juce::jlimit(-1.0f, 1.0f, 2.0f * (float)i / (numSamples - 1) - 1.0f + 0.1f * (random.nextFloat() - 0.5f));
+
+        std::vector<float> original(input, input + numSamples);
+
+        for (auto drive : { 0.5f, 1.0f, 4.0f, 20.0f })
+        {
+            // The drive multiply is the kernel's own float one; the curve is what's under test.
+            std::vector<double> referenceOutput((size_t)numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                referenceOutput[(size_t)i] = reference((double)(drive * original[(size_t)i]));
+
+            std::copy(original.begin(), original.end(), input);
+            applyCurve<Curve>(input, (size_t)numSamples, drive);
+
+            expectNull(getErrorDecibels(input, referenceOutput.data(), numSamples), toleranceDecibels,
+                       juce::String(name) + " at drive " + juce::String(drive));
+        }
+    }
+
+    void testWaveshaperCurves()
+    {
+        beginTest("Waveshaper curves against the exact functions");
+
+        auto clamp = [](double x) { return juce::jlimit(-1.0, 1.0, x); };
+
+        checkCurve<TanhCurve>("Tanh", [](double x) { return std::tanh(x); }, Tolerance::approximateCurve);
+        checkCurve<TubeCurve>("Tube", [](double x) { return std::tanh(x + 0.25) - std::tanh(0.25); }, Tolerance::approximateCurve);
+        checkCurve<SoftClipCurve>("SoftClip", [clamp](double x) { x = clamp(x); return x * (1.5 - 0.5 * x * x); }, Tolerance::exactCurve);
+        checkCurve<HardClipCurve>("HardClip", clamp, Tolerance::exactCurve);
+        checkCurve<FoldbackCurve>("Foldback", [](double x)
+        {
+            auto wrapped = (x - 1.0) - 4.0 * std::floor((x - 1.0) / 4.0);
+            return std::abs(wrapped - 2.0) - 1.0;
+        }, Tolerance::exactCurve);
+    }
+
+    void testOversampledDistortion()
+    {
+        beginTest("Oversampled DistortionStage against the exact curves");
+
+        constexpr double sampleRate = 48000.0;
+        constexpr int numSamples = 8192;
+        constexpr float drive = 4.0f;
+
+        struct Shape { WaveshaperCurve curve; const char* name; double (*reference)(double); };
+        const Shape shapes[] = {
+            { WaveshaperCurve::softClip, "SoftClip", [](double x) { x = juce::jlimit(-1.0, 1.0, x); return x * (1.5 - 0.5 * x * x); } },
+            { WaveshaperCurve::hardClip, "HardClip", [](double x) { return juce::jlimit(-1.0, 1.0, x); } }
+        };
+
+        for (int factorIndex = 1; factorIndex < DistortionStage::numFactors; ++factorIndex)
+        {
+            for (auto linearPhase : { false, true })
+            {
+                for (auto& shape : shapes)
+                {
+                    DistortionStage stage;
+                    stage.prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+                    stage.setCurve(shape.curve);
+                    stage.setDrive(drive);
+                    stage.setOversampling(factorIndex, linearPhase);
+                    stage.reset();
+
+                    // A separate oversampler of the same kind, with the curve run in double
+                    // on its upsampled signal.
+                    DistortionStage::Oversampler reference(2, (size_t)factorIndex,
+                                                           linearPhase ? DistortionStage::Oversampler::filterHalfBandFIREquiripple
+                                                                       : DistortionStage::Oversampler::filterHalfBandPolyphaseIIR,
+                                                           true, true);
+                    reference.initProcessing((size_t)blockSize);
+
+                    juce::AudioBuffer<float> buffer(2, numSamples);
+                    fillNoise(buffer, getRandom());
+                    juce::AudioBuffer<float> expected(buffer);
+
+                    for (int start = 0; start < numSamples; start += blockSize)
+                    {
+                        auto slice = juce::dsp::AudioBlock<float>(buffer).getSubBlock((size_t)start, (size_t)blockSize);
+                        stage.process(juce::dsp::ProcessContextReplacing<float>(slice));
+
+                        auto expectedSlice = juce::dsp::AudioBlock<float>(expected).getSubBlock((size_t)start, (size_t)blockSize);
+                        auto upsampled = reference.processSamplesUp(expectedSlice);
+
+                        for (size_t ch = 0; ch < upsampled.getNumChannels(); ++ch)
+                        {
+                            auto* samples = upsampled.getChannelPointer(ch);
+
+                            for (size_t i = 0; i < upsampled.getNumSamples(); ++i)
+                                samples[i] = (float)shape.reference((double)(drive * samples[i]));
+                        }
+
+                        reference.processSamplesDown(expectedSlice);
+                    }
+
+                    auto what = juce::String(shape.name) + " at " + juce::String(1 << factorIndex) + "x, "
+                              + (linearPhase ? "linear phase" : "IIR");
+
+                    expectEquals(stage.getLatencySamples(), juce::roundToInt(reference.getLatencyInSamples()), what + " latency");
+
+                    for (int ch = 0; ch < 2; ++ch)
+                        expectNull(getErrorDecibels(buffer.getReadPointer(ch), expected.getReadPointer(ch), numSamples),
+                                   Tolerance::oversampledCurve, what + ", channel " + juce::String(ch));
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    std::vector<FilterRegion> getFilterRegions() const
+    {
+        const float frequencies[] = { 20.0f, 200.0f, 2000.0f, 20000.0f };
+        std::vector<FilterRegion> regions;
+
+        // Every cut frequency and slope, with the low and high cut at opposite ends.
+        for (int f = 0; f < 4; ++f)
+            for (int numSections = 1; numSections <= LockstepChain::maxCutSections; ++numSections)
+                regions.push_back({ frequencies[f], frequencies[3 - f], numSections, 1000.0f, 1.0f, 0.0f });
+
+        // Every corner of the Peak's range between wide-open cuts.
+        for (auto frequency : frequencies)
+            for (auto quality : { 0.1f, 1.0f, 10.0f })
+                for (auto decibels : { -24.0f, 0.0f, 24.0f })
+                    regions.push_back({ 20.0f, 20000.0f, 1, frequency, quality, decibels });
+
+        return regions;
+    }
+
+    /// Renders the region through a LockstepChain and through the reference. With a
+    /// designed region, the chain is designed for that instead and every stage is
+    /// retuned per sample to the region's frequencies.
+    void checkFilterChain(const FilterRegion& region, double sampleRate, int numChannels, const FilterRegion* designed)
+    {
+        FilterRegion clamped = region;
+        clamped.lowCut = (float)clampFrequency(sampleRate, region.lowCut);
+        clamped.highCut = (float)clampFrequency(sampleRate, region.highCut);
+        clamped.peakFrequency = (float)clampFrequency(sampleRate, region.peakFrequency);
+
+        LockstepChain::CutCoefficients lowCut, highCut;
+        SVFCoefficients peak;
+        designChain(designed != nullptr ? *designed : clamped, sampleRate, lowCut, peak, highCut);
+
+        LockstepChain chain;
+        chain.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels });
+        chain.setCoefficients(lowCut, peak, highCut);
+        chain.setNumCutSections(region.numSections, region.numSections);
+
+        constexpr int numSamples = 8192;
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        fillNoise(buffer, getRandom());
+
+        std::vector<std::vector<double>> expected((size_t)numChannels);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto sections = makeReferenceChain(clamped, sampleRate);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto y = (double)buffer.getSample(ch, i);
+
+                for (auto& section : sections)
+                    y = section.process(y);
+
+                expected[(size_t)ch].push_back(y);
+            }
+        }
+
+        // Per-sample tuning at the target frequencies, all constant.
+        std::vector<float> tunings[LockstepChain::numStages];
+
+        if (designed != nullptr)
+        {
+            const float frequencies[] = { clamped.lowCut, clamped.peakFrequency, clamped.highCut };
+
+            for (int stage = 0; stage < LockstepChain::numStages; ++stage)
+                tunings[stage].assign((size_t)blockSize, (float)std::tan(juce::MathConstants<double>::pi * frequencies[stage] / sampleRate));
+        }
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            if (designed != nullptr)
+                for (int stage = 0; stage < LockstepChain::numStages; ++stage)
+                    chain.setTuning((LockstepChain::Stage)stage, tunings[stage].data());
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            auto slice = block.getSubBlock((size_t)start, (size_t)juce::jmin(blockSize, numSamples - start));
+            chain.process(juce::dsp::ProcessContextReplacing<float>(slice));
+        }
+
+        auto error = -400.0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            error = juce::jmax(error, getErrorDecibels(buffer.getReadPointer(ch), expected[(size_t)ch].data(), numSamples));
+
+        expectNull(error, Tolerance::filterChain, region.describe() + " at " + juce::String(sampleRate) + " Hz, "
+                                                  + juce::String(numChannels) + " channels");
+    }
+
+    void testFilterChain()
+    {
+        beginTest("LockstepChain against a double biquad cascade");
+
+        // One channel leaves spare lanes, six spill into a second register.
+        for (auto sampleRate : sampleRates)
+            for (auto numChannels : { 1, 2, 6 })
+                for (auto& region : getFilterRegions())
+                    checkFilterChain(region, sampleRate, numChannels, nullptr);
+    }
+
+    void testTunedFilterChain()
+    {
+        beginTest("Retuned LockstepChain against a double biquad cascade");
+
+        // Designed at one set of frequencies and retuned per sample to the region's, the
+        // sections keep their damping and output mix and must land on the region's design.
+        const FilterRegion designed{ 1000.0f, 1000.0f, 1, 1000.0f, 1.0f, 0.0f };
+
+        for (auto sampleRate : sampleRates)
+        {
+            for (auto region : getFilterRegions())
+            {
+                auto from = designed;
+                from.numSections = region.numSections;
+                from.peakQuality = region.peakQuality;
+                from.peakDecibels = region.peakDecibels;
+                checkFilterChain(region, sampleRate, 2, &from);
+            }
+        }
+    }
+
+    void testFilterChainBypassFade()
+    {
+        beginTest("LockstepChain bypass fades across a block longer than the fade");
+
+        // A 512-sample block holds the whole 10 ms fade at 48 kHz, so the first block
+        // after the toggle is also the fade's last.
+        constexpr double sampleRate = 48000.0;
+        const FilterRegion region{ 1000.0f, 20000.0f, 1, 1000.0f, 1.0f, 0.0f };
+
+        LockstepChain::CutCoefficients lowCut, highCut;
+        SVFCoefficients peak;
+        designChain(region, sampleRate, lowCut, peak, highCut);
+
+        LockstepChain chain;
+        chain.prepare({ sampleRate, (juce::uint32)blockSize, 1 });
+        chain.setCoefficients(lowCut, peak, highCut);
+
+        // DC through the LowCut settles to silence, and bypassing it brings the DC back.
+        juce::AudioBuffer<float> buffer(1, blockSize);
+
+        auto processDC = [&]
+        {
+            buffer.clear();
+            juce::FloatVectorOperations::fill(buffer.getWritePointer(0), 1.0f, blockSize);
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+            return buffer.getReadPointer(0);
+        };
+
+        for (int i = 0; i < 40; ++i)
+            processDC();
+
+        chain.setStageBypassed(LockstepChain::lowCutStage, true);
+        auto* output = processDC();
+
+        auto fadeSamples = StageBypass::fadeSeconds * sampleRate;
+        auto largestStep = 0.0f;
+
+        for (int i = 1; i < blockSize; ++i)
+            largestStep = juce::jmax(largestStep, std::abs(output[i] - output[i - 1]));
+
+        expect(std::abs(output[0]) < 0.01f, "the fade starts from the filtered signal, got " + juce::String(output[0]));
+        expect(largestStep < 2.0f / (float)fadeSamples, "largest step " + juce::String(largestStep) + " is not a ramp");
+        expect(std::abs(output[blockSize - 1] - 1.0f) < 1.0e-3f, "the fade ends on the dry signal, got " + juce::String(output[blockSize - 1]));
+    }
+
+    void testDuckerDepthRamp()
+    {
+        beginTest("SidechainDucker ramps its depth in and out");
+
+        // A steady full-scale sidechain holds the envelope at 1, so the wet gain is
+        // 1 - depth and any step in the depth shows up as a step in the gain.
+        constexpr double sampleRate = 48000.0;
+        constexpr int numBlocks = 20;
+
+        SidechainDucker ducker;
+        ducker.prepare(sampleRate, blockSize);
+        ducker.setTimes(1.0f, 250.0f);
+
+        juce::AudioBuffer<float> sidechain(1, blockSize);
+        juce::FloatVectorOperations::fill(sidechain.getWritePointer(0), 1.0f, blockSize);
+
+        auto largestStep = 0.0f, previousGain = 1.0f;
+
+        auto processBlocks = [&](int count)
+        {
+            for (int b = 0; b < count; ++b)
+            {
+                auto* gains = ducker.process(juce::dsp::AudioBlock<const float>(sidechain));
+
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    auto gain = gains != nullptr ? gains[i] : 1.0f;
+                    largestStep = juce::jmax(largestStep, std::abs(gain - previousGain));
+                    previousGain = gain;
+                }
+            }
+        };
+
+        // Let the envelope's attack settle before looking at the depth.
+        ducker.setDepth(0.8f);
+        processBlocks(numBlocks);
+        largestStep = 0.0f;
+
+        ducker.setDepth(0.0f);
+        processBlocks(numBlocks);
+        expect(std::abs(previousGain - 1.0f) < 1.0e-6f, "depth 0 leaves the wet signal alone, got " + juce::String(previousGain));
+
+        ducker.setDepth(0.8f);
+        processBlocks(numBlocks);
+        expect(std::abs(previousGain - 0.2f) < 1.0e-3f, "the depth ramps back in, got " + juce::String(previousGain));
+
+        auto rampSamples = SidechainDucker::depthRampSeconds * sampleRate;
+        expect(largestStep < 2.0f * 0.8f / (float)rampSamples, "largest step " + juce::String(largestStep) + " is not a ramp");
+    }
+
+    //==============================================================================
+    void testPartitionedConvolver()
+    {
+        beginTest("PartitionedConvolver against direct convolution");
+
+        constexpr int numSamples = 49152;
+        auto& random = getRandom();
+
+        // Lengths either side of the head, of each partition size and of each stage's
+        // start, up to several of the largest partitions, which are spread over the most
+        // steps.
+        for (auto length : { 1, 64, 65, 600, 1024, 1025, 5000, 8192, 8193, 40000 })
+        {
+            juce::AudioBuffer<float> impulse(1, length);
+
+            for (int i = 0; i < length; ++i)
+                impulse.setSample(0, i, (random.nextFloat() - 0.5f) * std::exp(-4.0f * (float)i / (float)length));
+
+            auto ir = PartitionedIR::build(impulse);
+
+            juce::AudioBuffer<float> input(1, numSamples);
+            fillNoise(input, random);
+
+            std::vector<double> expected((size_t)numSamples, 0.0);
+            auto* x = input.getReadPointer(0);
+            auto* h = impulse.getReadPointer(0);
+            auto peak = 0.0;
+
+            for (int n = 0; n < numSamples; ++n)
+            {
+                for (int k = 0; k <= juce::jmin(n, length - 1); ++k)
+                    expected[(size_t)n] += (double)h[k] * x[n - k];
+
+                peak = juce::jmax(peak, std::abs(expected[(size_t)n]));
+            }
+
+            // Long responses gain up noise past full scale, so they're scaled back to it.
+            auto scale = juce::jmax(1.0, peak);
+
+            for (auto& sample : expected)
+                sample /= scale;
+
+            // Host blocks that straddle every partition boundary, in place.
+            for (auto hostBlock : { 1, 37, 512, 4096 })
+            {
+                PartitionedConvolver convolver(*ir, 0);
+                juce::AudioBuffer<float> output(input);
+
+                for (int start = 0; start < numSamples; start += hostBlock)
+                {
+                    auto* samples = output.getWritePointer(0, start);
+                    convolver.process(samples, samples, juce::jmin(hostBlock, numSamples - start));
+                }
+
+                output.applyGain((float)(1.0 / scale));
+
+                expectNull(getErrorDecibels(output.getReadPointer(0), expected.data(), numSamples), Tolerance::convolution,
+                           juce::String(length) + " taps in blocks of " + juce::String(hostBlock));
+            }
+        }
+    }
+
+    /// The FIR LinearPhaseCuts is specified to build: the cascades' magnitude sampled on
+    /// fftSize bins, taken back to the time domain with zero phase, centred on the
+    /// latency tap and Blackman windowed. All in double.
+    std::vector<double> designLinearPhaseReference(double sampleRate, int latency, float lowCut, int numLowCut,
+                                                   float highCut, int numHighCut) const
+    {
+        auto fftSize = 2 * (latency + 1);
+        auto numBins = fftSize / 2 + 1;
+        std::vector<double> magnitude((size_t)numBins, 1.0);
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            auto omega = juce::MathConstants<double>::twoPi * bin / fftSize;
+
+            for (int i = 0; i < numLowCut; ++i)
+                magnitude[(size_t)bin] *= ReferenceBiquad::highPass(sampleRate, lowCut, getCutSectionQ(numLowCut, i)).getMagnitude(omega);
+
+            for (int i = 0; i < numHighCut; ++i)
+                magnitude[(size_t)bin] *= ReferenceBiquad::lowPass(sampleRate, highCut, getCutSectionQ(numHighCut, i)).getMagnitude(omega);
+        }
+
+        // A real, even spectrum: the inverse transform is a cosine sum, and the taps are
+        // symmetric about the centre.
+        std::vector<double> cosines((size_t)fftSize);
+
+        for (int n = 0; n < fftSize; ++n)
+            cosines[(size_t)n] = std::cos(juce::MathConstants<double>::twoPi * n / fftSize);
+
+        auto numTaps = fftSize - 1;
+        std::vector<double> taps((size_t)numTaps);
+
+        for (int offset = 0; offset <= latency; ++offset)
+        {
+            auto sum = magnitude[0] + magnitude[(size_t)numBins - 1] * (offset % 2 == 0 ? 1.0 : -1.0);
+
+            for (int bin = 1; bin < numBins - 1; ++bin)
+                sum += 2.0 * magnitude[(size_t)bin] * cosines[(size_t)(((juce::int64)bin * offset) % fftSize)];
+
+            taps[(size_t)(latency + offset)] = taps[(size_t)(latency - offset)] = sum / fftSize;
+        }
+
+        for (int i = 0; i < numTaps; ++i)
+        {
+            auto phase = juce::MathConstants<double>::twoPi * i / (numTaps - 1);
+            taps[(size_t)i] *= 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+        }
+
+        return taps;
+    }
+
+    void testLinearPhaseCuts()
+    {
+        beginTest("LinearPhaseCuts against a double FIR design");
+
+        struct Response { float lowCut; int numLowCut; float highCut; int numHighCut; };
+        const Response responses[] = { { 200.0f, 2, 8000.0f, 1 }, { 20.0f, 4, 20000.0f, 4 }, { 1000.0f, 1, 1200.0f, 3 } };
+
+        for (auto sampleRate : { 44100.0, 96000.0 })
+        {
+            for (auto& response : responses)
+            {
+                // Three channels: one convolution on a pair and one on its own.
+                constexpr int numChannels = 3;
+
+                LinearPhaseCuts cuts;
+                cuts.setResponse(response.lowCut, response.numLowCut, response.highCut, response.numHighCut);
+                cuts.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels });
+
+                auto latency = cuts.getLatencySamples();
+                auto taps = designLinearPhaseReference(sampleRate, latency, response.lowCut, response.numLowCut,
+                                                       response.highCut, response.numHighCut);
+                auto numTaps = (int)taps.size();
+
+                // From the very first block, so the FIR has to be in place the moment
+                // prepare() returns for the output to line up with the reported latency.
+                auto numSamples = numTaps + 4 * blockSize;
+                juce::AudioBuffer<float> buffer(numChannels, numSamples);
+                fillNoise(buffer, getRandom());
+                juce::AudioBuffer<float> input(buffer);
+
+                for (int start = 0; start < numSamples; start += blockSize)
+                {
+                    auto slice = juce::dsp::AudioBlock<float>(buffer).getSubBlock((size_t)start, (size_t)juce::jmin(blockSize, numSamples - start));
+                    cuts.process(juce::dsp::ProcessContextReplacing<float>(slice));
+                }
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    std::vector<double> expected((size_t)numSamples, 0.0);
+                    auto* x = input.getReadPointer(ch);
+
+                    for (int n = 0; n < numSamples; ++n)
+                        for (int k = 0; k <= juce::jmin(n, numTaps - 1); ++k)
+                            expected[(size_t)n] += taps[(size_t)k] * x[n - k];
+
+                    expectNull(getErrorDecibels(buffer.getReadPointer(ch), expected.data(), numSamples), Tolerance::linearPhaseCuts,
+                               "cuts " + juce::String(response.lowCut) + " Hz x" + juce::String(response.numLowCut) + "/"
+                               + juce::String(response.highCut) + " Hz x" + juce::String(response.numHighCut) + " at "
+                               + juce::String(sampleRate) + " Hz, channel " + juce::String(ch));
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    void checkReverb(juce::Reverb::Parameters parameters, double sampleRate, int numChannels, bool freezeHalfway)
+    {
+        constexpr int numSamples = 32768;
+
+        // Same order for both: the parameters, then the rate, so neither ramps in.
+        juce::Reverb reference;
+        reference.setParameters(parameters);
+        reference.setSampleRate(sampleRate);
+
+        StereoReverb reverb;
+        reverb.setParameters(parameters);
+        reverb.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels });
+
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        fillNoise(buffer, getRandom());
+        juce::AudioBuffer<float> expected(buffer);
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            if (freezeHalfway && start == numSamples / 2)
+            {
+                parameters.freezeMode = 1.0f;
+                reference.setParameters(parameters);
+                reverb.setParameters(parameters);
+            }
+
+            auto numBlockSamples = juce::jmin(blockSize, numSamples - start);
+
+            if (numChannels == 1)
+                reference.processMono(expected.getWritePointer(0, start), numBlockSamples);
+            else
+                reference.processStereo(expected.getWritePointer(0, start), expected.getWritePointer(1, start), numBlockSamples);
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            auto slice = block.getSubBlock((size_t)start, (size_t)numBlockSamples);
+            reverb.process(juce::dsp::ProcessContextReplacing<float>(slice));
+        }
+
+        auto error = -400.0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            error = juce::jmax(error, getErrorDecibels(buffer.getReadPointer(ch), expected.getReadPointer(ch), numSamples));
+
+        expectNull(error, Tolerance::reverb, "room " + juce::String(parameters.roomSize) + ", width " + juce::String(parameters.width)
+                                             + (freezeHalfway ? ", frozen" : "") + " at " + juce::String(sampleRate) + " Hz, "
+                                             + juce::String(numChannels) + " channels");
+    }
+
+    void testStereoReverb()
+    {
+        beginTest("StereoReverb against juce::Reverb");
+
+        for (auto sampleRate : { 44100.0, 96000.0 })
+        {
+            for (auto numChannels : { 1, 2 })
+            {
+                for (auto roomSize : { 0.0f, 0.5f, 1.0f })
+                {
+                    for (auto width : { 0.0f, 1.0f })
+                    {
+                        juce::Reverb::Parameters parameters;
+                        parameters.roomSize = roomSize;
+                        parameters.width = width;
+                        checkReverb(parameters, sampleRate, numChannels, false);
+                    }
+                }
+
+                checkReverb({}, sampleRate, numChannels, true);
+            }
+        }
+    }
+
+    //==============================================================================
+    void testHalfBandRoundTrip()
+    {
+        beginTest("HalfBandFilter down and up against the delayed input");
+
+        for (auto sampleRate : { 96000.0, 192000.0 })
+        {
+            HalfBandFilter decimator, interpolator;
+            decimator.prepare(sampleRate, StereoReverb::passbandFrequency, StereoReverb::stopbandDecibels, blockSize);
+            interpolator.prepare(sampleRate, StereoReverb::passbandFrequency, StereoReverb::stopbandDecibels, blockSize);
+
+            auto latency = decimator.getDecimationLatency() + interpolator.getInterpolationLatency();
+
+            for (auto frequency : { 100.0, 1000.0, 10000.0, 18000.0 })
+            {
+                constexpr int numSamples = 16384;
+                std::vector<float> input((size_t)numSamples), output((size_t)numSamples), low((size_t)blockSize / 2);
+
+                for (int i = 0; i < numSamples; ++i)
+                    input[(size_t)i] = (float)std::sin(juce::MathConstants<double>::twoPi * frequency * i / sampleRate);
+
+                decimator.reset();
+                interpolator.reset();
+
+                for (int start = 0; start < numSamples; start += blockSize)
+                {
+                    decimator.decimate(input.data() + start, low.data(), blockSize);
+                    interpolator.interpolate(low.data(), output.data() + start, blockSize / 2);
+                }
+
+                // Past the filters' settling, the output is the input latency samples later.
+                auto settled = 4 * latency;
+                auto error = getErrorDecibels(output.data() + settled, input.data() + settled - latency, numSamples - settled);
+
+                expectNull(error, Tolerance::halfBandRoundTrip, juce::String(frequency) + " Hz at " + juce::String(sampleRate) + " Hz");
+            }
+        }
+    }
+
+    void testReducedRateDryPath()
+    {
+        beginTest("Reduced-rate StereoReverb with no wet signal passes its input");
+
+        juce::Reverb::Parameters parameters;
+        parameters.wetLevel = 0.0f;
+        parameters.dryLevel = 0.5f; // unity after juce::Reverb's scaling
+
+        for (auto sampleRate : { 96000.0, 192000.0 })
+        {
+            constexpr int numSamples = 16384;
+
+            StereoReverb reverb;
+            reverb.setParameters(parameters);
+            reverb.prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+            reverb.setReducedRate(true);
+            expect(reverb.isReducedRate());
+
+            juce::AudioBuffer<float> buffer(2, numSamples);
+            fillNoise(buffer, getRandom());
+            juce::AudioBuffer<float> input(buffer);
+
+            // Odd host blocks leave part of a tank sample pending every time.
+            for (int start = 0; start < numSamples; start += 333)
+            {
+                juce::dsp::AudioBlock<float> block(buffer);
+                auto slice = block.getSubBlock((size_t)start, (size_t)juce::jmin(333, numSamples - start));
+                reverb.process(juce::dsp::ProcessContextReplacing<float>(slice));
+            }
+
+            for (int ch = 0; ch < 2; ++ch)
+                expectNull(getErrorDecibels(buffer.getReadPointer(ch), input.getReadPointer(ch), numSamples),
+                           Tolerance::reducedRateDryPath, "channel " + juce::String(ch) + " at " + juce::String(sampleRate) + " Hz");
+        }
+    }
+
+    void testReducedRateWetPath()
+    {
+        beginTest("Reduced-rate StereoReverb wet path against juce::Reverb at the tank's rate");
+
+        juce::Reverb::Parameters parameters;
+        parameters.dryLevel = 0.0f;
+
+        for (auto sampleRate : { 96000.0, 192000.0 })
+        {
+            constexpr int numSamples = 32768;
+            auto factor = StereoReverb::getReducedRateFactor(sampleRate);
+            auto numTankSamples = numSamples / factor;
+
+            StereoReverb reverb;
+            reverb.setParameters(parameters);
+            reverb.prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+            reverb.setReducedRate(true);
+
+            juce::AudioBuffer<float> buffer(2, numSamples);
+            fillNoise(buffer, getRandom());
+
+            // The reference takes the tank's input down a half-band at a time in one pass,
+            // runs juce::Reverb at the tank's rate and comes back up the same way. Its
+            // round trip is delayed by the half-bands' latency, which the reverb has to
+            // have read ahead by.
+            std::vector<float> down((size_t)numSamples), low((size_t)numSamples);
+            juce::FloatVectorOperations::add(down.data(), buffer.getReadPointer(0), buffer.getReadPointer(1), numSamples);
+
+            std::vector<std::unique_ptr<HalfBandFilter>> interpolators;
+            auto latency = 0;
+
+            for (int stageFactor = 1; stageFactor < factor; stageFactor *= 2)
+            {
+                auto stageRate = sampleRate / stageFactor;
+                auto stageSamples = numSamples / stageFactor;
+
+                HalfBandFilter decimator;
+                decimator.prepare(stageRate, StereoReverb::passbandFrequency, StereoReverb::stopbandDecibels, stageSamples);
+                decimator.decimate(down.data(), low.data(), stageSamples);
+                std::copy(low.begin(), low.begin() + stageSamples / 2, down.begin());
+
+                for (int ch = 0; ch < 2; ++ch)
+                {
+                    interpolators.push_back(std::make_unique<HalfBandFilter>());
+                    interpolators.back()->prepare(stageRate, StereoReverb::passbandFrequency, StereoReverb::stopbandDecibels, stageSamples);
+                }
+
+                latency += stageFactor * (decimator.getDecimationLatency() + interpolators.back()->getInterpolationLatency());
+            }
+
+            // Parameters, then the rate, so nothing ramps in.
+            juce::Reverb tank;
+            tank.setParameters(parameters);
+            tank.setSampleRate(sampleRate / factor);
+
+            juce::AudioBuffer<float> expected(2, numSamples);
+            expected.clear();
+            expected.copyFrom(0, 0, down.data(), numTankSamples);
+            tank.processStereo(expected.getWritePointer(0), expected.getWritePointer(1), numTankSamples);
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* samples = expected.getWritePointer(ch);
+
+                for (int stageSamples = numTankSamples, stage = (int)interpolators.size() / 2; --stage >= 0; stageSamples *= 2)
+                {
+                    std::copy(samples, samples + stageSamples, low.begin());
+                    interpolators[(size_t)(stage * 2 + ch)]->interpolate(low.data(), samples, stageSamples);
+                }
+            }
+
+            // Odd host blocks leave part of a tank sample pending every time.
+            for (int start = 0; start < numSamples; start += 333)
+            {
+                juce::dsp::AudioBlock<float> block(buffer);
+                auto slice = block.getSubBlock((size_t)start, (size_t)juce::jmin(333, numSamples - start));
+                reverb.process(juce::dsp::ProcessContextReplacing<float>(slice));
+            }
+
+            for (int ch = 0; ch < 2; ++ch)
+                expectNull(getErrorDecibels(buffer.getReadPointer(ch), expected.getReadPointer(ch) + latency, numSamples - latency),
+                           Tolerance::reducedRateWetPath, "channel " + juce::String(ch) + " at " + juce::String(sampleRate) + " Hz");
+        }
+    }
+};
+
+static NullTests nullTests;
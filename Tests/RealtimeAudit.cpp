@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.cpp
+    Catches the audio thread doing what it mustn't. While an audit is running
+    on a thread, every heap allocation, free and lock taken on that thread is
+    counted. The counts come from interposing malloc, free and the pthread
+    locking functions for the whole test executable, so this is glibc-only.
+
+  ==============================================================================
+*/
+
+#include "RealtimeAudit.h"
+
+#include <cerrno>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <pthread.h>
+
+// glibc's own allocator entry points, which the replacements below forward to.
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+}
+
+namespace
+{
+    enum Kind
+    {
+        allocation, deallocation, lock, numKinds
+    };
+
+    // Plain zero-initialised thread-locals in the executable live in static TLS, so
+    // reading them from inside malloc can't itself allocate.
+    thread_local bool auditing = false;
+    thread_local int counts[numKinds] = {};
+
+    std::atomic<bool> abortOnViolation{ false };
+
+    void note(Kind kind) noexcept
+    {
+        if (! auditing)
+            return;
+
+        ++counts[kind];
+
+        if (abortOnViolation.load(std::memory_order_relaxed))
+            std::abort();
+    }
+
+    // The real locking functions are found on first use. A race only means two
+    // threads look the same symbol up.
+    template <typename Function>
+    Function findNext(std::atomic<Function>& cache, const char* name) noexcept
+    {
+        auto function = cache.load(std::memory_order_acquire);
+
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+            cache.store(function, std::memory_order_release);
+        }
+
+        return function;
+    }
+
+    using MutexFunction = int (*)(pthread_mutex_t*);
+    using RwLockFunction = int (*)(pthread_rwlock_t*);
+
+    std::atomic<MutexFunction> nextMutexLock{ nullptr }, nextMutexTryLock{ nullptr };
+    std::atomic<RwLockFunction> nextReadLock{ nullptr }, nextWriteLock{ nullptr };
+}
+
+//==============================================================================
+extern "C"
+{
+    void* malloc(size_t size) noexcept
+    {
+        note(allocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        note(allocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) noexcept
+    {
+        note(allocation);
+        return __libc_realloc(pointer, size);
+    }
+
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        note(allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        note(allocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size) noexcept
+    {
+        note(allocation);
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr || size == 0 ? 0 : ENOMEM;
+    }
+
+    void free(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            note(deallocation);
+
+        __libc_free(pointer);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+    {
+        note(lock);
+        return findNext(nextMutexLock, "pthread_mutex_lock")(mutex);
+    }
+
+    int pthread_mutex_trylock(pthread_mutex_t* mutex) noexcept
+    {
+        note(lock);
+        return findNext(nextMutexTryLock, "pthread_mutex_trylock")(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock) noexcept
+    {
+        note(lock);
+        return findNext(nextReadLock, "pthread_rwlock_rdlock")(rwlock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock) noexcept
+    {
+        note(lock);
+        return findNext(nextWriteLock, "pthread_rwlock_wrlock")(rwlock);
+    }
+}
+
+//==============================================================================
+namespace RealtimeAudit
+{
+    juce::String Violations::describe() const
+    {
+        return juce::String(allocations) + " allocations, " + juce::String(deallocations) + " frees, "
+             + juce::String(locks) + " locks";
+    }
+
+    void begin() noexcept
+    {
+        jassert(! auditing);
+        std::fill(std::begin(counts), std::end(counts), 0);
+        auditing = true;
+    }
+
+    Violations end() noexcept
+    {
+        auditing = false;
+        return { counts[allocation], counts[deallocation], counts[lock] };
+    }
+
+    void setAbortOnViolation(bool shouldAbort) noexcept
+    {
+        abortOnViolation = shouldAbort;
+    }
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    RealtimeAudit.h
+    Catches the audio thread doing what it mustn't. While an audit is running
+    on a thread, every heap allocation, free and lock taken on that thread is
+    counted. The counts come from interposing malloc, free and the pthread
+    locking functions for the whole test executable, so this is glibc-only.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace RealtimeAudit
+{
+    struct Violations
+    {
+        int allocations = 0, deallocations = 0, locks = 0;
+
+        bool any() const noexcept { return allocations + deallocations + locks > 0; }
+        juce::String describe() const;
+    };
+
+    /// Starts counting on the calling thread. Audits don't nest.
+    void begin() noexcept;
+
+    /// Stops counting and returns what the thread did since begin().
+    Violations end() noexcept;
+
+    /// Aborts at the first violation instead of counting it, so a debugger stops
+    /// on the offending call.
+    void setAbortOnViolation(bool shouldAbort) noexcept;
+}
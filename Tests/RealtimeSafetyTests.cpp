@@ -0,0 +1,482 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyTests.cpp
+    Drives AudioFXAudioProcessor the way a host would, with every processBlock()
+    run under a RealtimeAudit: a block that allocates, frees or takes a lock
+    fails. Parameters are moved on this thread between blocks, so each block
+    also applies whatever the move dirtied. Covers every parameter region,
+    layouts, block sizes, both precisions, modulation switching off and
+    subnormal, NaN and infinite input.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeAudit.h"
+
+namespace
+{
+    constexpr int maxBlockSize = 512;
+
+    /// Noise at -12 dBFS with a full-scale click at the start of every 1000 samples,
+    /// so the level detectors and the waveshaper see some peaks.
+    template <typename Sample>
+    void fillSignal(juce::AudioBuffer<Sample>& buffer, juce::Random& random)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample(ch, i, (Sample)(i % 1000 == 0 ? 1.0f : 0.5f * (random.nextFloat() - 0.5f)));
+    }
+
+    template <typename Sample>
+    bool isFinite(const juce::AudioBuffer<Sample>& buffer)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                if (! std::isfinite(buffer.getSample(ch, i)))
+                    return false;
+
+        return true;
+    }
+
+    bool isSubnormal(float x) noexcept
+    {
+        return std::fpclassify(x) == FP_SUBNORMAL;
+    }
+
+    void prepare(AudioFXAudioProcessor& processor, double sampleRate, int blockSize)
+    {
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+    }
+
+    void setParameter(AudioFXAudioProcessor& processor, const char* id, float normalisedValue)
+    {
+        processor.apvts.getParameter(id)->setValueNotifyingHost(normalisedValue);
+    }
+
+    /// Every choice of a discrete parameter; both ends and the middle of a continuous one.
+    juce::Array<float> getRegions(const juce::AudioProcessorParameter& parameter)
+    {
+        constexpr int maxSteps = 16;
+        auto numSteps = parameter.getNumSteps();
+
+        if (! parameter.isDiscrete() || numSteps < 2 || numSteps > maxSteps)
+            return { 0.0f, 0.5f, 1.0f };
+
+        juce::Array<float> regions;
+
+        for (int step = 0; step < numSteps; ++step)
+            regions.add((float)step / (float)(numSteps - 1));
+
+        return regions;
+    }
+}
+
+//==============================================================================
+class RealtimeSafetyTests : public juce::UnitTest
+{
+public:
+    RealtimeSafetyTests() : juce::UnitTest("Real-time safety", "AudioFX") {}
+
+    void runTest() override
+    {
+        testAudit();
+        testParameterRegions();
+        testBlockSizes();
+        testLayouts();
+        testSidechain();
+        testDoublePrecision();
+        testModulationRelease();
+        testTelemetry();
+        testPresets();
+        testSubnormals();
+        testNonFiniteInput();
+    }
+
+private:
+    juce::MidiBuffer midi;
+
+    /// One processBlock() under an audit. Everything that builds the failure message
+    /// happens after the audit ends.
+    template <typename Sample>
+    void processAudited(AudioFXAudioProcessor& processor, juce::AudioBuffer<Sample>& buffer, const juce::String& what)
+    {
+        RealtimeAudit::begin();
+        processor.processBlock(buffer, midi);
+        auto violations = RealtimeAudit::end();
+
+        if (violations.any())
+            expect(false, what + ": " + violations.describe());
+    }
+
+    /// Renders numBlocks of the test signal, and unless told otherwise checks it stays finite.
+    void render(AudioFXAudioProcessor& processor, int numChannels, int numBlocks, const juce::String& what, bool expectFinite = true)
+    {
+        juce::AudioBuffer<float> buffer(numChannels, maxBlockSize);
+        auto finite = true;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            fillSignal(buffer, getRandom());
+            processAudited(processor, buffer, what);
+            finite = finite && isFinite(buffer);
+        }
+
+        if (expectFinite)
+            expect(finite, what + ": non-finite output");
+    }
+
+    //==============================================================================
+    void testAudit()
+    {
+        beginTest("The audit sees allocations and locks");
+
+        std::mutex mutex;
+
+        RealtimeAudit::begin();
+        {
+            juce::MemoryBlock block(64);
+            const std::lock_guard<std::mutex> lock(mutex);
+        }
+        auto violations = RealtimeAudit::end();
+
+        expect(violations.allocations > 0 && violations.deallocations > 0 && violations.locks > 0, violations.describe());
+
+        RealtimeAudit::begin();
+        auto nothing = RealtimeAudit::end();
+        expect(! nothing.any(), nothing.describe());
+    }
+
+    void testParameterRegions()
+    {
+        beginTest("Every parameter region");
+
+        // Long enough for the bypass and order fades to finish and idle stages to
+        // be skipped.
+        constexpr int blocksPerRegion = 8;
+
+        for (auto sampleRate : { 44100.0, 96000.0, 192000.0 })
+        {
+            AudioFXAudioProcessor processor;
+            prepare(processor, sampleRate, maxBlockSize);
+            render(processor, 2, 2, "first blocks at " + juce::String(sampleRate) + " Hz");
+
+            for (auto* parameter : processor.getParameters())
+            {
+                auto defaultValue = parameter->getDefaultValue();
+                auto name = parameter->getName(64);
+
+                for (auto region : getRegions(*parameter))
+                {
+                    parameter->setValueNotifyingHost(region);
+                    render(processor, 2, blocksPerRegion, name + " at " + juce::String(region) + ", " + juce::String(sampleRate) + " Hz");
+                }
+
+                parameter->setValueNotifyingHost(defaultValue);
+                render(processor, 2, 1, name + " back to its default");
+            }
+        }
+    }
+
+    void testBlockSizes()
+    {
+        beginTest("Host blocks of any size up to the prepared one");
+
+        AudioFXAudioProcessor processor;
+
+        // Modulation retunes the filters per sample, over whatever length the block is.
+        for (auto* id : { "LfoToLowCut", "LfoToPeak", "LfoToHighCut", "EnvToGain" })
+            setParameter(processor, id, 0.75f);
+
+        setParameter(processor, "Oversampling", 1.0f);
+        prepare(processor, 48000.0, maxBlockSize);
+
+        auto finite = true;
+
+        for (auto numSamples : { 1, 333, 512, 17, 0, 64, 511 })
+        {
+            juce::AudioBuffer<float> buffer(2, numSamples);
+            fillSignal(buffer, getRandom());
+            processAudited(processor, buffer, juce::String(numSamples) + "-sample block");
+            finite = finite && isFinite(buffer);
+        }
+
+        expect(finite, "non-finite output");
+    }
+
+    void testLayouts()
+    {
+        beginTest("Mono, stereo and multichannel layouts");
+
+        for (auto numChannels : { 1, 2, 3, 6, AudioFXAudioProcessor::maxChannels })
+        {
+            AudioFXAudioProcessor processor;
+
+            auto layout = processor.getBusesLayout();
+            layout.inputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+            layout.outputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+            expect(processor.setBusesLayout(layout));
+
+            prepare(processor, 96000.0, maxBlockSize);
+
+            auto what = juce::String(numChannels) + " channels";
+            render(processor, numChannels, 4, what);
+
+            // Both reverb modes and the reduced-rate tank have their own per-channel paths.
+            setParameter(processor, "ReverbRate", 1.0f);
+            render(processor, numChannels, 4, what + ", reduced-rate reverb");
+
+            setParameter(processor, "ReverbMode", 1.0f);
+            render(processor, numChannels, 4, what + ", convolution reverb");
+
+            setParameter(processor, "CutFilter", 1.0f);
+            render(processor, numChannels, 4, what + ", linear-phase cuts");
+        }
+    }
+
+    void testSidechain()
+    {
+        beginTest("Sidechain ducking");
+
+        AudioFXAudioProcessor processor;
+        expect(processor.getBus(true, 1)->enable());
+        setParameter(processor, "DuckDepth", 1.0f);
+        prepare(processor, 48000.0, maxBlockSize);
+
+        // The host's buffer carries the main bus and then the sidechain.
+        render(processor, 4, 16, "ducked by the sidechain");
+
+        // A silent sidechain lets the ducker go quiet.
+        juce::AudioBuffer<float> buffer(4, maxBlockSize);
+
+        for (int block = 0; block < 8; ++block)
+        {
+            fillSignal(buffer, getRandom());
+            buffer.clear(2, 0, maxBlockSize);
+            buffer.clear(3, 0, maxBlockSize);
+            processAudited(processor, buffer, "silent sidechain");
+        }
+    }
+
+    void testDoublePrecision()
+    {
+        beginTest("64-bit blocks match 32-bit ones");
+
+        // Both run the same float chain, so their output is identical sample for sample.
+        AudioFXAudioProcessor single, twin;
+
+        for (auto* processor : { &single, &twin })
+        {
+            setParameter(*processor, "Gain", 0.5f);
+            setParameter(*processor, "LfoToPeak", 0.75f);
+            prepare(*processor, 48000.0, maxBlockSize);
+        }
+
+        juce::AudioBuffer<float> buffer(2, maxBlockSize);
+        juce::AudioBuffer<double> doubleBuffer(2, maxBlockSize);
+        auto maxDifference = 0.0;
+
+        for (int block = 0; block < 16; ++block)
+        {
+            fillSignal(buffer, getRandom());
+            doubleBuffer.makeCopyOf(buffer);
+
+            processAudited(single, buffer, "32-bit block");
+            processAudited(twin, doubleBuffer, "64-bit block");
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < maxBlockSize; ++i)
+                    maxDifference = juce::jmax(maxDifference, std::abs((double)buffer.getSample(ch, i) - doubleBuffer.getSample(ch, i)));
+        }
+
+        expectEquals(maxDifference, 0.0);
+    }
+
+    void testModulationRelease()
+    {
+        beginTest("Filters land on their design when modulation stops");
+
+        // One processor retunes its LowCut while the LFO moves it and then switches the
+        // LFO off; the other is set to the same cutoff from the start. Once both have
+        // settled, the same input has to give the same output.
+        AudioFXAudioProcessor modulated, steady;
+        auto lowCutoff = modulated.apvts.getParameter("LowCutoff")->convertTo0to1(500.0f);
+
+        for (auto* processor : { &modulated, &steady })
+        {
+            setParameter(*processor, "ReverbBypass", 1.0f);
+            prepare(*processor, 48000.0, maxBlockSize);
+        }
+
+        setParameter(steady, "LowCutoff", lowCutoff);
+
+        juce::AudioBuffer<float> buffer(2, maxBlockSize), steadyBuffer(2, maxBlockSize);
+        auto maxDifference = 0.0f;
+
+        auto renderBoth = [&](int numBlocks, const juce::String& what)
+        {
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                fillSignal(buffer, getRandom());
+                steadyBuffer.makeCopyOf(buffer);
+
+                processAudited(modulated, buffer, what);
+                processAudited(steady, steadyBuffer, what);
+
+                maxDifference = 0.0f;
+
+                for (int ch = 0; ch < 2; ++ch)
+                    for (int i = 0; i < maxBlockSize; ++i)
+                        maxDifference = juce::jmax(maxDifference, std::abs(buffer.getSample(ch, i) - steadyBuffer.getSample(ch, i)));
+            }
+        };
+
+        setParameter(modulated, "LfoToLowCut", 0.75f);
+        renderBoth(4, "LFO on the LowCut");
+
+        setParameter(modulated, "LowCutoff", lowCutoff);
+        renderBoth(20, "LowCut gliding under the LFO");
+
+        setParameter(modulated, "LfoToLowCut", 0.5f);
+        renderBoth(20, "LFO off again");
+
+        expect(maxDifference < 1.0e-4f, "largest difference after the LFO stops: " + juce::String(maxDifference));
+    }
+
+    void testTelemetry()
+    {
+        beginTest("Metering and analysis");
+
+        AudioFXAudioProcessor processor;
+        prepare(processor, 48000.0, maxBlockSize);
+        processor.setMeteringEnabled(true);
+        processor.setAnalysisEnabled(true);
+
+        // More blocks than the queues hold, with nobody reading them.
+        render(processor, 2, 256, "metering and analysing");
+    }
+
+    void testPresets()
+    {
+        beginTest("Preset recall and morphing");
+
+        AudioFXAudioProcessor processor;
+        prepare(processor, 48000.0, maxBlockSize);
+
+        processor.storePreset(0);
+        setParameter(processor, "Gain", 1.0f);
+        setParameter(processor, "PeakGain", 1.0f);
+        setParameter(processor, "LowCutSlope", 1.0f);
+        setParameter(processor, "StageOrder", 1.0f);
+        processor.storePreset(1);
+
+        expect(processor.recallPreset(0));
+        render(processor, 2, 4, "recalled preset");
+
+        expect(processor.setMorphPair(0, 1));
+
+        for (int step = 0; step <= 16; ++step)
+        {
+            setParameter(processor, "Morph", (float)step / 16.0f);
+            render(processor, 2, 1, "morph at " + juce::String(step) + "/16");
+        }
+
+        processor.clearMorph();
+        render(processor, 2, 2, "after morphing");
+    }
+
+    //==============================================================================
+    void testSubnormals()
+    {
+        beginTest("Subnormal input and decaying tails");
+
+        AudioFXAudioProcessor processor;
+        setParameter(processor, "RoomSize", 1.0f);
+        prepare(processor, 48000.0, maxBlockSize);
+
+        // Subnormal input can only come out unchanged, where a silent stage passed it
+        // straight through; nothing computed from it may be subnormal.
+        juce::AudioBuffer<float> buffer(2, maxBlockSize), input(2, maxBlockSize);
+        auto& random = getRandom();
+        auto badSamples = 0;
+
+        for (int block = 0; block < 8; ++block)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < maxBlockSize; ++i)
+                    buffer.setSample(ch, i, (random.nextFloat() - 0.5f) * std::numeric_limits<float>::min());
+
+            input.makeCopyOf(buffer);
+            processAudited(processor, buffer, "subnormal input");
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < maxBlockSize; ++i)
+                    if (auto x = buffer.getSample(ch, i); ! std::isfinite(x) || (isSubnormal(x) && x != input.getSample(ch, i)))
+                        ++badSamples;
+        }
+
+        expectEquals(badSamples, 0, "subnormal or non-finite samples from subnormal input");
+
+        // A loud burst, then the longest tail left to decay through silence.
+        render(processor, 2, 4, "burst before silence");
+
+        auto numSilentBlocks = (int)(processor.getTailLengthSeconds() * 48000.0) / maxBlockSize + 16;
+        badSamples = 0;
+
+        for (int block = 0; block < numSilentBlocks; ++block)
+        {
+            buffer.clear();
+            processAudited(processor, buffer, "decaying tail");
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < maxBlockSize; ++i)
+                    if (auto x = buffer.getSample(ch, i); ! std::isfinite(x) || isSubnormal(x))
+                        ++badSamples;
+        }
+
+        expectEquals(badSamples, 0, "subnormal or non-finite samples in the tail");
+    }
+
+    void testNonFiniteInput()
+    {
+        beginTest("NaN and infinite input");
+
+        for (auto cutMode : { 0.0f, 1.0f })
+        {
+            AudioFXAudioProcessor processor;
+            setParameter(processor, "CutFilter", cutMode);
+            setParameter(processor, "Oversampling", 1.0f);
+            setParameter(processor, "LfoToPeak", 0.75f);
+            setParameter(processor, "EnvToLowCut", 0.75f);
+            prepare(processor, 48000.0, maxBlockSize);
+
+            auto what = cutMode > 0.5f ? juce::String("linear-phase cuts") : juce::String("IIR cuts");
+            render(processor, 2, 2, what);
+
+            // Whatever comes out, poisoned input mustn't send the processor down a path
+            // that allocates or locks.
+            juce::AudioBuffer<float> buffer(2, maxBlockSize);
+            fillSignal(buffer, getRandom());
+            buffer.setSample(0, 100, std::numeric_limits<float>::quiet_NaN());
+            buffer.setSample(1, 200, std::numeric_limits<float>::infinity());
+            buffer.setSample(0, 300, -std::numeric_limits<float>::infinity());
+            processAudited(processor, buffer, what + ", poisoned block");
+
+            render(processor, 2, 4, what + ", after the poisoned block", false);
+
+            // A host's reset() on a transport jump has to clear every stage's state,
+            // on the audio thread.
+            RealtimeAudit::begin();
+            processor.reset();
+            auto violations = RealtimeAudit::end();
+            expect(! violations.any(), "reset(): " + violations.describe());
+
+            render(processor, 2, 8, what + ", after reset()");
+        }
+    }
+};
+
+static RealtimeSafetyTests realtimeSafetyTests;
@@ -0,0 +1,379 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Headless batch renderer: runs the AudioFX processor over a list of audio
+    files on a pool of worker threads, one processor instance per worker. Cores
+    left over when there are fewer files than threads go to each processor's
+    own channel-parallel rendering.
+
+    Usage:
+      AudioFXBatchRender [options] <input files...>
+
+      --preset <file>    State blob saved by the plugin, an XML dump of the
+                         parameter tree, or a text file of "ParamID = value" lines
+      --out <dir>        Output directory (default: ./rendered)
+      --format wav|flac  Output format (default: same as each input)
+      --block <n>        Samples per processBlock call (default: 8192)
+      --threads <n>      Worker threads (default: number of cores)
+      --tail <seconds>   Extra output after the input ends (default: the
+                         processor's reported tail length)
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <iostream>
+
+namespace
+{
+    struct RenderSettings
+    {
+        juce::MemoryBlock state;
+        juce::File outputDirectory;
+        juce::String outputFormat;
+        int blockSize = 8192;
+        double tailSeconds = -1.0;
+    };
+
+    struct RenderResult
+    {
+        bool ok = false;
+        juce::String message;
+        double audioSeconds = 0.0;
+    };
+
+    //==============================================================================
+    bool applyParameterFile(AudioFXAudioProcessor& processor, const juce::String& text, juce::String& error)
+    {
+        for (auto line : juce::StringArray::fromLines(text))
+        {
+            line = line.upToFirstOccurrenceOf("#", false, false).trim();
+
+            if (line.isEmpty())
+                continue;
+
+            auto id = line.upToFirstOccurrenceOf("=", false, false).trim();
+            auto value = line.fromFirstOccurrenceOf("=", false, false).trim();
+            auto* parameter = processor.apvts.getParameter(id);
+
+            if (parameter == nullptr || value.isEmpty())
+            {
+                error = "bad parameter line: " + line;
+                return false;
+            }
+
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value.getFloatValue()));
+        }
+
+        return true;
+    }
+
+    bool loadPreset(AudioFXAudioProcessor& processor, const juce::File& file, juce::String& error)
+    {
+        juce::MemoryBlock data;
+
+        if (! file.loadFileAsData(data))
+        {
+            error = "can't read " + file.getFullPathName();
+            return false;
+        }
+
+        // Blobs from getStateInformation always contain null bytes; text presets never do.
+        auto isBinary = std::memchr(data.getData(), 0, data.getSize()) != nullptr;
+
+        if (isBinary)
+        {
+            processor.setStateInformation(data.getData(), (int)data.getSize());
+            return true;
+        }
+
+        auto text = data.toString().trimStart();
+
+        if (text.startsWithChar('<'))
+        {
+            if (auto xml = juce::parseXML(text))
+            {
+                auto tree = juce::ValueTree::fromXml(*xml);
+
+                if (tree.hasType(processor.apvts.state.getType()))
+                {
+                    processor.apvts.replaceState(tree);
+                    return true;
+                }
+            }
+
+            error = "not an AudioFX parameter tree: " + file.getFullPathName();
+            return false;
+        }
+
+        return applyParameterFile(processor, text, error);
+    }
+
+    int chooseBitDepth(juce::AudioFormat& format, const juce::AudioFormatReader& reader)
+    {
+        auto depths = format.getPossibleBitDepths();
+        auto wanted = reader.usesFloatingPointData ? 32 : (int)reader.bitsPerSample;
+
+        if (depths.contains(wanted))
+            return wanted;
+
+        // Otherwise the deepest the format offers, e.g. 24 for float sources going to FLAC.
+        auto best = 16;
+
+        for (auto depth : depths)
+            best = juce::jmax(best, depth);
+
+        return best;
+    }
+
+    //==============================================================================
+    RenderResult renderFile(AudioFXAudioProcessor& processor, juce::AudioFormatManager& formats,
+                            const juce::File& input, const RenderSettings& settings)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+
+        if (reader == nullptr)
+            return { false, "unreadable or unsupported format" };
+
+        auto numChannels = (int)reader->numChannels;
+        auto sampleRate = reader->sampleRate;
+
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+        layout.outputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+        if (! processor.setBusesLayout(layout))
+            return { false, "unsupported channel count " + juce::String(numChannels) };
+
+        auto extension = settings.outputFormat.isNotEmpty() ? "." + settings.outputFormat
+                                                            : input.getFileExtension();
+        auto* format = formats.findFormatForFileExtension(extension);
+
+        if (format == nullptr)
+            return { false, "no writer for " + extension };
+
+        auto outputFile = settings.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+        outputFile.deleteFile();
+
+        std::unique_ptr<juce::OutputStream> stream(outputFile.createOutputStream());
+
+        if (stream == nullptr)
+            return { false, "can't create " + outputFile.getFullPathName() };
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels,
+                                                                                chooseBitDepth(*format, *reader), {}, 0));
+
+        if (writer == nullptr)
+            return { false, "can't write " + format->getFormatName() + " with this channel count or rate" };
+
+        stream.release(); // the writer owns it now
+
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(sampleRate, settings.blockSize);
+        processor.setStateInformation(settings.state.getData(), (int)settings.state.getSize());
+        processor.prepareToPlay(sampleRate, settings.blockSize);
+
+        // Feed silence past the end of the input to flush the latency and the reverb
+        // tail, and drop the first `latency` output samples so the render lines up.
+        auto tailSeconds = settings.tailSeconds >= 0.0 ? settings.tailSeconds : processor.getTailLengthSeconds();
+        auto latency = (juce::int64)processor.getLatencySamples();
+        auto totalOutput = reader->lengthInSamples + (juce::int64)std::ceil(tailSeconds * sampleRate);
+        auto totalInput = totalOutput + latency;
+
+        juce::AudioBuffer<float> buffer(numChannels, settings.blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 inputPosition = 0, written = 0;
+        auto ok = true;
+
+        while (ok && written < totalOutput)
+        {
+            auto numSamples = (int)juce::jmin((juce::int64)settings.blockSize, totalInput - inputPosition);
+            buffer.setSize(numChannels, numSamples, false, false, true);
+
+            // Reads past the end of the file come back as silence.
+            reader->read(&buffer, 0, numSamples, inputPosition, true, true);
+            processor.processBlock(buffer, midi);
+
+            auto skip = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, latency - inputPosition);
+            auto numToWrite = (int)juce::jmin((juce::int64)(numSamples - skip), totalOutput - written);
+
+            if (numToWrite > 0)
+                ok = writer->writeFromAudioSampleBuffer(buffer, skip, numToWrite);
+
+            inputPosition += numSamples;
+            written += juce::jmax(0, numToWrite);
+        }
+
+        if (! ok)
+            return { false, "write failed for " + outputFile.getFullPathName() };
+
+        return { true, outputFile.getFullPathName(), (double)totalOutput / sampleRate };
+    }
+
+    //==============================================================================
+    struct BatchJob
+    {
+        juce::Array<juce::File> files;
+        RenderSettings settings;
+
+        std::atomic<int> nextFile{ 0 };
+
+        juce::CriticalSection lock;
+        int numSucceeded = 0, numFailed = 0;
+        double audioSeconds = 0.0;
+
+        void report(const juce::File& file, const RenderResult& result)
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (result.ok)
+            {
+                ++numSucceeded;
+                audioSeconds += result.audioSeconds;
+                std::cout << "ok    " << file.getFileName() << " -> " << result.message << std::endl;
+            }
+            else
+            {
+                ++numFailed;
+                std::cerr << "FAIL  " << file.getFileName() << ": " << result.message << std::endl;
+            }
+        }
+    };
+
+    class RenderWorker : public juce::Thread
+    {
+    public:
+        RenderWorker(BatchJob& jobToRun, int numRenderWorkers)
+            : juce::Thread("AudioFX render worker"), job(jobToRun)
+        {
+            formats.registerBasicFormats();
+            processor.setMaxRenderWorkers(numRenderWorkers);
+        }
+
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                auto index = job.nextFile++;
+
+                if (index >= job.files.size())
+                    break;
+
+                auto& file = job.files.getReference(index);
+                job.report(file, renderFile(processor, formats, file, job.settings));
+            }
+
+            // Only once the last file is done: the processor's render threads are
+            // reused from one file to the next.
+            processor.releaseResources();
+        }
+
+    private:
+        BatchJob& job;
+        AudioFXAudioProcessor processor;
+        juce::AudioFormatManager formats;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorker)
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: AudioFXBatchRender [--preset <file>] [--out <dir>] [--format wav|flac]\n"
+                     "                          [--block <n>] [--threads <n>] [--tail <seconds>] <files...>"
+                  << std::endl;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // The processors' parameter trees start timers, which need a message manager
+    // even though nothing here ever opens a window.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    BatchJob job;
+    job.settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile("rendered");
+
+    juce::File presetFile;
+    auto numThreads = juce::SystemStats::getNumCpus();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String arg(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--preset" && hasValue)        presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--out" && hasValue)      job.settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--format" && hasValue)   job.settings.outputFormat = juce::String(argv[++i]).toLowerCase().trimCharactersAtStart(".");
+        else if (arg == "--block" && hasValue)    job.settings.blockSize = juce::jlimit(32, 1 << 16, juce::String(argv[++i]).getIntValue());
+        else if (arg == "--threads" && hasValue)  numThreads = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        else if (arg == "--tail" && hasValue)     job.settings.tailSeconds = juce::String(argv[++i]).getDoubleValue();
+        else if (arg.startsWith("--"))
+        {
+            printUsage();
+            return 2;
+        }
+        else
+        {
+            job.files.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+        }
+    }
+
+    if (job.files.isEmpty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    // Resolve the preset once into the plugin's own state format, so every worker
+    // restores exactly the same thing whatever the preset file looked like.
+    {
+        AudioFXAudioProcessor presetLoader;
+        juce::String error;
+
+        if (presetFile != juce::File() && ! loadPreset(presetLoader, presetFile, error))
+        {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+
+        presetLoader.getStateInformation(job.settings.state);
+    }
+
+    if (! job.settings.outputDirectory.createDirectory())
+    {
+        std::cerr << "can't create " << job.settings.outputDirectory.getFullPathName() << std::endl;
+        return 2;
+    }
+
+    numThreads = juce::jmin(numThreads, job.files.size());
+
+    // Files already keep numThreads cores busy; each processor only gets threads of its
+    // own for whatever cores that leaves, so the total never oversubscribes them.
+    auto numRenderWorkers = juce::jmax(0, juce::SystemStats::getNumCpus() / numThreads - 1);
+
+    juce::OwnedArray<RenderWorker> workers;
+
+    for (int i = 0; i < numThreads; ++i)
+        workers.add(new RenderWorker(job, numRenderWorkers));
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    for (auto* worker : workers)
+        worker->startThread();
+
+    for (auto* worker : workers)
+        worker->waitForThreadToExit(-1);
+
+    auto seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    std::cout << "\n" << job.numSucceeded << " rendered, " << job.numFailed << " failed, "
+              << numThreads << " threads, " << juce::String(seconds, 2) << " s\n"
+              << juce::String(job.numSucceeded / juce::jmax(seconds, 1.0e-9), 2) << " files/s, "
+              << juce::String(job.audioSeconds / juce::jmax(seconds, 1.0e-9), 1) << "x real time" << std::endl;
+
+    return job.numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,463 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Microbenchmarks for AudioFXAudioProcessor::processBlock and for each stage of
+    the chain on its own, written out as JSON so releases can be compared.
+
+    Usage:
+      AudioFXBenchmark [options]
+
+      --out <file>       Write the JSON here instead of to stdout
+      --stages <list>    Comma-separated subset of Chain, ChainDouble, ChainModulated,
+                         WaveShape, LowCut, Peak, HighCut, Reverberation,
+                         ReverberationReduced (default: all)
+      --rates <list>     Sample rates in Hz (default: 44100,48000,88200,96000,176400,192000)
+      --blocks <list>    Block sizes (default: 16,32,64,128,256,512,1024,2048,4096)
+      --seconds <s>      Audio rendered per timed run (default: 1)
+      --runs <n>         Timed runs per case; the median is reported (default: 5)
+      --profile <dir>    Record the Chain cases with the built-in profiler and write
+                         AudioFX-trace.json (Chrome trace) and AudioFX-profile.txt
+                         here. Needs a build configured with AUDIOFX_PROFILING=ON.
+
+    Every case runs once with static parameters and once with the stage's
+    parameters changed before every block. Times are per stereo sample frame.
+    ChainDouble is the Chain case fed through the 64-bit processBlock, as a
+    double-precision host would call it; when both are run, "doubleOverhead"
+    lists what ChainDouble costs over Chain for every rate and block size.
+    ChainModulated routes the LFO and the
+    envelope to every filter and the drive, so each filter is retuned per sample.
+    ReverberationReduced runs the tank at its reduced rate, which from 96 kHz up
+    is a half or a quarter of the session rate.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+#include <iostream>
+
+namespace
+{
+    constexpr int numChannels = 2;
+
+    /** One thing being timed: the whole processor or a single stage. */
+    struct Subject
+    {
+        virtual ~Subject() = default;
+
+        virtual void prepare(double sampleRate, int blockSize) = 0;
+
+        /** Called outside the timed region, e.g. for host-side parameter changes, with
+            the block about to be processed. */
+        virtual void beginBlock(const juce::AudioBuffer<float>& /*buffer*/, int /*blockIndex*/, bool /*automated*/) {}
+
+        /** The timed part. Stages that own their coefficient math redo it in here when
+            automated, since that's where processBlock would pay for it too. */
+        virtual void process(juce::AudioBuffer<float>& buffer, int blockIndex, bool automated) = 0;
+
+        /** The processor's own profiler, for subjects that run the whole processor. */
+        virtual Profiler* getProfiler() { return nullptr; }
+    };
+
+    /** Sweeps 0..1 and back over 64 blocks, so every automated block sees a new value. */
+    float automationPhase(int blockIndex)
+    {
+        auto position = blockIndex % 128;
+        return (float)(position < 64 ? position : 127 - position) / 63.0f;
+    }
+
+    juce::dsp::ProcessSpec makeSpec(double sampleRate, int blockSize)
+    {
+        return { sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels };
+    }
+
+    //==============================================================================
+    struct ChainSubject : public Subject
+    {
+        ChainSubject(bool useDoublePrecision, bool useModulation)
+            : doublePrecision(useDoublePrecision), modulated(useModulation) {}
+
+        void prepare(double sampleRate, int blockSize) override
+        {
+            // The depths run -1..1, so 0.5 routes nothing.
+            for (auto* id : { "LfoToLowCut", "LfoToPeak", "LfoToHighCut", "EnvToGain" })
+                processor.apvts.getParameter(id)->setValueNotifyingHost(modulated ? 0.75f : 0.5f);
+
+            processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor.prepareToPlay(sampleRate, blockSize);
+        }
+
+        void beginBlock(const juce::AudioBuffer<float>& buffer, int blockIndex, bool automated) override
+        {
+            // The host's own buffer is already 64-bit, so widening it isn't timed.
+            if (doublePrecision)
+                doubleBuffer.makeCopyOf(buffer, true);
+
+            if (! automated)
+                return;
+
+            auto phase = automationPhase(blockIndex);
+
+            for (auto* id : { "Gain", "LowCutoff", "PeakFreq", "HighCutoff", "RoomSize" })
+                processor.apvts.getParameter(id)->setValueNotifyingHost(phase);
+        }
+
+        void process(juce::AudioBuffer<float>& buffer, int, bool) override
+        {
+            if (doublePrecision)
+                processor.processBlock(doubleBuffer, midi);
+            else
+                processor.processBlock(buffer, midi);
+        }
+
+        Profiler* getProfiler() override { return &processor.getProfiler(); }
+
+        const bool doublePrecision, modulated;
+        AudioFXAudioProcessor processor;
+        juce::AudioBuffer<double> doubleBuffer;
+        juce::MidiBuffer midi;
+    };
+
+    struct WaveShapeSubject : public Subject
+    {
+        void prepare(double sampleRate, int blockSize) override
+        {
+            stage.prepare(makeSpec(sampleRate, blockSize));
+            stage.setOversampling(0, false);
+            stage.setDrive(juce::Decibels::decibelsToGain(12.0f));
+        }
+
+        void process(juce::AudioBuffer<float>& buffer, int blockIndex, bool automated) override
+        {
+            if (automated)
+                stage.setDrive(juce::Decibels::decibelsToGain(30.0f * automationPhase(blockIndex)));
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            stage.process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+
+        DistortionStage stage;
+    };
+
+    struct FilterSubject : public Subject
+    {
+        explicit FilterSubject(LockstepChain::Stage stageToRun) : stageToTime(stageToRun)
+        {
+            chain.setCoefficients(lowCut, peak, highCut);
+
+            for (int i = 0; i < LockstepChain::numStages; ++i)
+                chain.setStageActive((LockstepChain::Stage)i, i == stageToTime);
+        }
+
+        void prepare(double newSampleRate, int blockSize) override
+        {
+            sampleRate = newSampleRate;
+            chain.prepare(makeSpec(sampleRate, blockSize));
+            design(0.5f);
+        }
+
+        void process(juce::AudioBuffer<float>& buffer, int blockIndex, bool automated) override
+        {
+            if (automated)
+                design(automationPhase(blockIndex));
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+
+        void design(float phase)
+        {
+            auto frequency = 20.0f * std::pow(1000.0f, phase);
+
+            switch (stageToTime)
+            {
+                case LockstepChain::lowCutStage:  designSVFHighPass(lowCut[0], sampleRate, frequency, 1.0f); break;
+                case LockstepChain::peakStage:    designSVFPeak(peak, sampleRate, frequency, 1.0f, 2.0f); break;
+                case LockstepChain::highCutStage: designSVFLowPass(highCut[0], sampleRate, frequency, 1.0f); break;
+                case LockstepChain::numStages:    break;
+            }
+        }
+
+        LockstepChain::Stage stageToTime;
+        LockstepChain::CutCoefficients lowCut, highCut;
+        SVFCoefficients peak;
+        LockstepChain chain;
+        double sampleRate = 44100.0;
+    };
+
+    struct ReverbSubject : public Subject
+    {
+        explicit ReverbSubject(bool reduced) : reducedRate(reduced) {}
+
+        void prepare(double sampleRate, int blockSize) override
+        {
+            reverb.setParameters(makeParameters(0.3f));
+            reverb.setReducedRate(reducedRate);
+            reverb.prepare(makeSpec(sampleRate, blockSize));
+        }
+
+        void process(juce::AudioBuffer<float>& buffer, int blockIndex, bool automated) override
+        {
+            if (automated)
+                reverb.setParameters(makeParameters(automationPhase(blockIndex)));
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            reverb.process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+
+        static StereoReverb::Parameters makeParameters(float roomSize)
+        {
+            StereoReverb::Parameters parameters;
+            parameters.roomSize = roomSize;
+            parameters.damping = roomSize;
+            parameters.width = 0.3f;
+            parameters.wetLevel = 0.5f;
+            parameters.dryLevel = 1.0f;
+            return parameters;
+        }
+
+        StereoReverb reverb;
+        bool reducedRate;
+    };
+
+    std::unique_ptr<Subject> createSubject(const juce::String& stage)
+    {
+        if (stage == "Chain")                return std::make_unique<ChainSubject>(false, false);
+        if (stage == "ChainDouble")          return std::make_unique<ChainSubject>(true, false);
+        if (stage == "ChainModulated")       return std::make_unique<ChainSubject>(false, true);
+        if (stage == "WaveShape")            return std::make_unique<WaveShapeSubject>();
+        if (stage == "LowCut")               return std::make_unique<FilterSubject>(LockstepChain::lowCutStage);
+        if (stage == "Peak")                 return std::make_unique<FilterSubject>(LockstepChain::peakStage);
+        if (stage == "HighCut")              return std::make_unique<FilterSubject>(LockstepChain::highCutStage);
+        if (stage == "Reverberation")        return std::make_unique<ReverbSubject>(false);
+        if (stage == "ReverberationReduced") return std::make_unique<ReverbSubject>(true);
+
+        return nullptr;
+    }
+
+    //==============================================================================
+    struct Measurement
+    {
+        double medianNsPerSample = 0.0, minNsPerSample = 0.0;
+    };
+
+    Measurement measure(Subject& subject, double sampleRate, int blockSize, bool automated,
+                        double secondsPerRun, int numRuns)
+    {
+        subject.prepare(sampleRate, blockSize);
+
+        // Noise at about -12 dBFS, refreshed before every block so nothing settles
+        // into silence or denormals.
+        juce::AudioBuffer<float> source(numChannels, blockSize), buffer(numChannels, blockSize);
+        juce::Random random(1234);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                source.setSample(ch, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+
+        auto numBlocks = juce::jmax(1, (int)(secondsPerRun * sampleRate / blockSize));
+        std::vector<double> nsPerSample;
+        int blockIndex = 0;
+
+        juce::ScopedNoDenormals noDenormals;
+
+        for (int run = -1; run < numRuns; ++run)
+        {
+            juce::int64 ticks = 0;
+
+            for (int b = 0; b < numBlocks; ++b, ++blockIndex)
+            {
+                buffer.makeCopyOf(source, true);
+                subject.beginBlock(buffer, blockIndex, automated);
+
+                auto start = juce::Time::getHighResolutionTicks();
+                subject.process(buffer, blockIndex, automated);
+                ticks += juce::Time::getHighResolutionTicks() - start;
+            }
+
+            // Run -1 only warms up caches and branch predictors.
+            if (run >= 0)
+                nsPerSample.push_back(juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / ((double)numBlocks * blockSize));
+        }
+
+        std::sort(nsPerSample.begin(), nsPerSample.end());
+        return { nsPerSample[nsPerSample.size() / 2], nsPerSample.front() };
+    }
+
+    //==============================================================================
+    bool writeProfile(const Profiler& profiler, const juce::File& directory)
+    {
+        auto summary = profiler.getSummary();
+        std::cerr << "\n" << summary << std::endl;
+
+        return directory.createDirectory()
+            && profiler.writeChromeTrace(directory.getChildFile("AudioFX-trace.json"))
+            && directory.getChildFile("AudioFX-profile.txt").replaceWithText(summary);
+    }
+
+    juce::StringArray parseList(const juce::String& text)
+    {
+        auto items = juce::StringArray::fromTokens(text, ",", "");
+        items.trim();
+        items.removeEmptyStrings();
+        return items;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray stages { "Chain", "ChainDouble", "ChainModulated", "WaveShape", "LowCut", "Peak", "HighCut", "Reverberation",
+                               "ReverberationReduced" };
+    juce::StringArray rates { "44100", "48000", "88200", "96000", "176400", "192000" };
+    juce::StringArray blocks { "16", "32", "64", "128", "256", "512", "1024", "2048", "4096" };
+    juce::File outputFile, profileDirectory;
+    double secondsPerRun = 1.0;
+    int numRuns = 5;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        juce::String arg(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--out" && hasValue)          outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else if (arg == "--stages" && hasValue)  stages = parseList(argv[++i]);
+        else if (arg == "--rates" && hasValue)   rates = parseList(argv[++i]);
+        else if (arg == "--blocks" && hasValue)  blocks = parseList(argv[++i]);
+        else if (arg == "--seconds" && hasValue) secondsPerRun = juce::jmax(0.01, juce::String(argv[++i]).getDoubleValue());
+        else if (arg == "--runs" && hasValue)    numRuns = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        else if (arg == "--profile" && hasValue) profileDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: AudioFXBenchmark [--out <file>] [--stages <list>] [--rates <list>]\n"
+                         "                        [--blocks <list>] [--seconds <s>] [--runs <n>]\n"
+                         "                        [--profile <dir>]" << std::endl;
+            return 2;
+        }
+    }
+
+    juce::Array<juce::var> results;
+
+    for (auto& stage : stages)
+    {
+        auto subject = createSubject(stage);
+
+        if (subject == nullptr)
+        {
+            std::cerr << "unknown stage " << stage << std::endl;
+            return 2;
+        }
+
+        auto* profiler = profileDirectory != juce::File() ? subject->getProfiler() : nullptr;
+
+        if (profiler != nullptr)
+        {
+           #if ! AUDIOFX_PROFILING
+            std::cerr << "warning: built without AUDIOFX_PROFILING, so the profile will be empty" << std::endl;
+           #endif
+            profiler->setEnabled(true);
+        }
+
+        for (auto& rate : rates)
+        {
+            for (auto& block : blocks)
+            {
+                for (auto automated : { false, true })
+                {
+                    auto sampleRate = rate.getDoubleValue();
+                    auto blockSize = block.getIntValue();
+                    auto measurement = measure(*subject, sampleRate, blockSize, automated, secondsPerRun, numRuns);
+
+                    auto* result = new juce::DynamicObject();
+                    result->setProperty("stage", stage);
+                    result->setProperty("sampleRate", sampleRate);
+                    result->setProperty("blockSize", blockSize);
+                    result->setProperty("parameters", automated ? "automated" : "static");
+                    result->setProperty("nsPerSample", measurement.medianNsPerSample);
+                    result->setProperty("nsPerSampleMin", measurement.minNsPerSample);
+                    result->setProperty("realtimeFactor", 1.0e9 / (measurement.medianNsPerSample * sampleRate));
+                    results.add(juce::var(result));
+
+                    std::cerr << stage << " " << rate << " Hz, " << block << " samples, "
+                              << (automated ? "automated" : "static") << ": "
+                              << juce::String(measurement.medianNsPerSample, 2) << " ns/sample" << std::endl;
+                }
+            }
+        }
+
+        if (profiler != nullptr)
+        {
+            profiler->setEnabled(false);
+
+            if (! writeProfile(*profiler, profileDirectory))
+            {
+                std::cerr << "can't write the profile to " << profileDirectory.getFullPathName() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // The 64-bit path narrows and widens around the float chain, so the difference
+    // between the two cases is the price a double-precision host pays for it.
+    juce::Array<juce::var> doubleOverhead;
+
+    for (auto& doubleResult : results)
+    {
+        if (doubleResult["stage"].toString() != "ChainDouble")
+            continue;
+
+        for (auto& floatResult : results)
+        {
+            if (floatResult["stage"].toString() != "Chain"
+                || (double)floatResult["sampleRate"] != (double)doubleResult["sampleRate"]
+                || (int)floatResult["blockSize"] != (int)doubleResult["blockSize"]
+                || floatResult["parameters"].toString() != doubleResult["parameters"].toString())
+                continue;
+
+            auto floatNs = (double)floatResult["nsPerSample"];
+            auto deltaNs = (double)doubleResult["nsPerSample"] - floatNs;
+            auto percent = floatNs > 0.0 ? 100.0 * deltaNs / floatNs : 0.0;
+
+            auto* overhead = new juce::DynamicObject();
+            overhead->setProperty("sampleRate", doubleResult["sampleRate"]);
+            overhead->setProperty("blockSize", doubleResult["blockSize"]);
+            overhead->setProperty("parameters", doubleResult["parameters"]);
+            overhead->setProperty("nsPerSample", deltaNs);
+            overhead->setProperty("percent", percent);
+            doubleOverhead.add(juce::var(overhead));
+
+            std::cerr << "ChainDouble over Chain " << doubleResult["sampleRate"].toString() << " Hz, "
+                      << doubleResult["blockSize"].toString() << " samples, " << doubleResult["parameters"].toString() << ": "
+                      << juce::String(deltaNs, 2) << " ns/sample (" << juce::String(percent, 1) << "%)" << std::endl;
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("benchmark", "AudioFX");
+    report->setProperty("version", ProjectInfo::versionString);
+    report->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+    report->setProperty("cpu", juce::SystemStats::getCpuModel());
+    report->setProperty("cores", juce::SystemStats::getNumCpus());
+    report->setProperty("secondsPerRun", secondsPerRun);
+    report->setProperty("runs", numRuns);
+    report->setProperty("results", results);
+
+    if (! doubleOverhead.isEmpty())
+        report->setProperty("doubleOverhead", doubleOverhead);
+
+    auto json = juce::JSON::toString(juce::var(report));
+
+    if (outputFile == juce::File())
+        std::cout << json << std::endl;
+    else if (! outputFile.replaceWithText(json))
+    {
+        std::cerr << "can't write " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}